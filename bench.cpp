@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "circuit.h"
+#include "partition.h"
+#include "qbfEncoder.h"
+#include "stats.h"
+#include "transform.h"
+
+// Generates Bristol circuits of a requested size, runs them through every
+// stage of the flow and reports per-stage time, throughput and peak RSS as
+// JSON. Stages run one after another in this process, so peak RSS is the
+// high-water mark up to the end of each stage.
+
+// Allocates wires in creation order; finish() moves the outputs to the last
+// wire IDs as the Bristol format requires.
+struct CircuitBuilder {
+    FlatNetlist netlist;
+    int nextWire = 0;
+
+    int input() { return nextWire++; }
+
+    int gate(uint8_t op, int a) {
+        int out = nextWire++;
+        netlist.addGate(op, &a, 1, &out, 1);
+        return out;
+    }
+
+    int gate(uint8_t op, int a, int b) {
+        int in[2] = {a, b};
+        int out = nextWire++;
+        netlist.addGate(op, in, 2, &out, 1);
+        return out;
+    }
+
+    // One MAND gate: out[i] = a[i] AND b[i].
+    std::vector<int> mand(const std::vector<int>& a, const std::vector<int>& b) {
+        std::vector<int> in(a);
+        in.insert(in.end(), b.begin(), b.end());
+        std::vector<int> out(a.size());
+        for (int& wire : out) {
+            wire = nextWire++;
+        }
+        netlist.addGate(OP_MAND, in.data(), in.size(), out.data(), out.size());
+        return out;
+    }
+
+    FlatNetlist finish(const std::vector<int>& inputCounts, const std::vector<int>& outputs) {
+        std::vector<int> rename(nextWire, -1);
+        int firstOutput = nextWire - static_cast<int>(outputs.size());
+        for (size_t k = 0; k < outputs.size(); ++k) {
+            rename[outputs[k]] = firstOutput + static_cast<int>(k);
+        }
+        int next = 0;
+        for (int w = 0; w < nextWire; ++w) {
+            if (rename[w] < 0) {
+                rename[w] = next++;
+            }
+        }
+        for (int& wire : netlist.wires) {
+            wire = rename[wire];
+        }
+        netlist.numGates = netlist.size();
+        netlist.numWires = nextWire;
+        netlist.inputWireCounts = inputCounts;
+        netlist.outputWireCounts.assign(1, static_cast<int>(outputs.size()));
+        return std::move(netlist);
+    }
+};
+
+// Sum and carry of a + b + carry; carry < 0 means none.
+int fullAdder(CircuitBuilder& b, int x, int y, int& carry) {
+    int t = b.gate(OP_XOR, x, y);
+    if (carry < 0) {
+        carry = b.gate(OP_AND, x, y);
+        return t;
+    }
+    int sum = b.gate(OP_XOR, t, carry);
+    carry = b.gate(OP_XOR, b.gate(OP_AND, x, y), b.gate(OP_AND, carry, t));
+    return sum;
+}
+
+// Ripple-carry adder, about 5 gates per bit.
+FlatNetlist generateAdder(long long targetGates) {
+    int n = std::max(1LL, targetGates / 5);
+    CircuitBuilder b;
+    std::vector<int> x(n), y(n), outputs;
+    for (int& wire : x) {
+        wire = b.input();
+    }
+    for (int& wire : y) {
+        wire = b.input();
+    }
+    int carry = -1;
+    for (int i = 0; i < n; ++i) {
+        outputs.push_back(fullAdder(b, x[i], y[i], carry));
+    }
+    outputs.push_back(carry);
+    return b.finish({n, n}, outputs);
+}
+
+// n x n array multiplier: AND partial products summed row by row with
+// ripple-carry adders, about 6n^2 gates.
+FlatNetlist generateMultiplier(long long targetGates) {
+    int n = std::max(2, static_cast<int>(std::sqrt(targetGates / 6.0)));
+    CircuitBuilder b;
+    std::vector<int> x(n), y(n);
+    for (int& wire : x) {
+        wire = b.input();
+    }
+    for (int& wire : y) {
+        wire = b.input();
+    }
+    // acc holds the running sum from bit i - 1 up
+    std::vector<int> outputs;
+    std::vector<int> acc;
+    for (int j = 0; j < n; ++j) {
+        acc.push_back(b.gate(OP_AND, x[j], y[0]));
+    }
+    for (int i = 1; i < n; ++i) {
+        outputs.push_back(acc[0]);
+        std::vector<int> next;
+        int carry = -1;
+        for (int j = 0; j < n; ++j) {
+            int pp = b.gate(OP_AND, x[j], y[i]);
+            if (j + 1 < static_cast<int>(acc.size())) {
+                next.push_back(fullAdder(b, acc[j + 1], pp, carry));
+            } else {
+                int halfCarry = -1;
+                next.push_back(fullAdder(b, pp, carry, halfCarry));
+                carry = halfCarry;
+            }
+        }
+        next.push_back(carry);
+        acc = next;
+    }
+    outputs.insert(outputs.end(), acc.begin(), acc.end());
+    return b.finish({n, n}, outputs);
+}
+
+// Unsigned a < b and a == b over n bits, LSB first, about 6 gates per bit.
+FlatNetlist generateComparator(long long targetGates) {
+    int n = std::max(1LL, targetGates / 6);
+    CircuitBuilder b;
+    std::vector<int> x(n), y(n);
+    for (int& wire : x) {
+        wire = b.input();
+    }
+    for (int& wire : y) {
+        wire = b.input();
+    }
+    int lt = b.gate(OP_AND, b.gate(OP_INV, x[0]), y[0]);
+    int eq = b.gate(OP_INV, b.gate(OP_XOR, x[0], y[0]));
+    for (int i = 1; i < n; ++i) {
+        // lt = d ? y : lt, with d = x ^ y
+        int d = b.gate(OP_XOR, x[i], y[i]);
+        lt = b.gate(OP_XOR, lt, b.gate(OP_AND, d, b.gate(OP_XOR, y[i], lt)));
+        eq = b.gate(OP_AND, eq, b.gate(OP_INV, d));
+    }
+    return b.finish({n, n}, {lt, eq});
+}
+
+// AES-like substitution-permutation network on a 128-bit state. Each round
+// runs 16 byte-wide S-boxes (two MAND layers between XOR mixing, 27 gates);
+// bit k of every byte then moves 5k bytes on, so each S-box feeds eight others.
+FlatNetlist generateSboxLayers(long long targetGates) {
+    const int BYTES = 16;
+    const int GATES_PER_ROUND = BYTES * 27;
+    long long rounds = std::max(1LL, targetGates / GATES_PER_ROUND);
+    CircuitBuilder b;
+    std::vector<int> state(8 * BYTES);
+    for (int& wire : state) {
+        wire = b.input();
+    }
+    std::vector<int> next(state.size());
+    for (long long r = 0; r < rounds; ++r) {
+        for (int byte = 0; byte < BYTES; ++byte) {
+            const int* x = &state[8 * byte];
+            std::vector<int> y(8), z(8);
+            for (int k = 0; k < 8; ++k) {
+                y[k] = b.gate(OP_XOR, x[k], x[(k + 1) % 8]);
+            }
+            std::vector<int> m = b.mand({y[0], y[1], y[2], y[3]}, {y[4], y[5], y[6], y[7]});
+            for (int k = 0; k < 8; ++k) {
+                z[k] = b.gate(OP_XOR, y[k], m[k % 4]);
+            }
+            std::vector<int> c = b.mand({z[0], z[1], z[2], z[3]}, {z[4], z[5], z[6], z[7]});
+            for (int k = 0; k < 8; ++k) {
+                int out = b.gate(OP_XOR, z[k], c[(k + 1) % 4]);
+                if (k == 0) {
+                    // affine constant, as in the AES S-box
+                    out = b.gate(OP_INV, out);
+                }
+                next[8 * ((byte + 5 * k) % BYTES) + k] = out;
+            }
+        }
+        state.swap(next);
+    }
+    return b.finish({8 * BYTES, 8 * BYTES}, state);
+}
+
+struct Family {
+    const char* name;
+    FlatNetlist (*generate)(long long);
+};
+
+const Family FAMILIES[] = {
+    {"adder", generateAdder},
+    {"multiplier", generateMultiplier},
+    {"comparator", generateComparator},
+    {"sbox", generateSboxLayers},
+};
+
+struct StageResult {
+    std::string name;
+    double seconds;
+    long long gates;
+    long long bytes;
+    long peakRssKb;
+};
+
+long long fileSize(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 ? static_cast<long long>(st.st_size) : 0;
+}
+
+// Times body() as one stage.
+template <class Body>
+void runStage(std::vector<StageResult>& stages, const char* name, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    StageResult result;
+    result.name = name;
+    result.gates = 0;
+    result.bytes = 0;
+    body(result);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.peakRssKb = peakRssKb();
+    stages.push_back(result);
+    std::cerr << "  " << name << ": " << result.seconds << " s" << std::endl;
+}
+
+struct BenchOptions {
+    std::string dir = ".";
+    int maxGates = 7;
+    int maxInputs = 6;
+    int encodeWindows = 1000;
+    bool keepFiles = false;
+};
+
+struct BenchResult {
+    std::string family;
+    long long targetGates;
+    long long gates;
+    long long wires;
+    long long triStateGates;
+    long long windows;
+    std::vector<StageResult> stages;
+};
+
+bool runBenchmark(const Family& family, long long targetGates, const BenchOptions& options, BenchResult& result) {
+    std::ostringstream base;
+    base << options.dir << "/bench_" << family.name << "_" << targetGates;
+    std::string bristolFile = base.str() + ".txt";
+    std::string triStateFile = base.str() + "_tri.txt";
+    std::string qbfFile = base.str() + ".qdimacs";
+    result.family = family.name;
+    result.targetGates = targetGates;
+    std::cerr << family.name << " " << targetGates << std::endl;
+
+    bool ok = true;
+    FlatNetlist gates;
+    runStage(result.stages, "generate", [&](StageResult& stage) {
+        gates = family.generate(targetGates);
+        stage.gates = gates.size();
+        ok = writeBristol(bristolFile, gates);
+        stage.bytes = fileSize(bristolFile);
+    });
+    result.gates = gates.size();
+    result.wires = gates.numWires;
+    gates = FlatNetlist();
+    if (!ok) {
+        return false;
+    }
+
+    runStage(result.stages, "parse", [&](StageResult& stage) {
+        ok = readBristol(bristolFile, gates);
+        stage.gates = gates.size();
+        stage.bytes = fileSize(bristolFile);
+    });
+    FlatNetlist triState;
+    runStage(result.stages, "transform", [&](StageResult& stage) {
+        ok = ok && transformCircuit(gates, triState);
+        stage.gates = gates.size();
+    });
+    result.triStateGates = triState.size();
+    runStage(result.stages, "output", [&](StageResult& stage) {
+        ok = ok && writeBristol(triStateFile, triState);
+        stage.gates = triState.size();
+        stage.bytes = fileSize(triStateFile);
+    });
+    gates = FlatNetlist();
+    triState = FlatNetlist();
+    if (!ok) {
+        return false;
+    }
+
+    Circuit circuit;
+    runStage(result.stages, "read_tristate", [&](StageResult& stage) {
+        circuit = readCircuit(triStateFile);
+        stage.gates = circuit.size();
+        stage.bytes = fileSize(triStateFile);
+    });
+    CircuitGraph graph;
+    runStage(result.stages, "topological_sort", [&](StageResult& stage) {
+        ok = buildCircuitGraph(circuit, graph);
+        stage.gates = circuit.size();
+    });
+    if (!ok) {
+        return false;
+    }
+    std::vector<Circuit> windows;
+    runStage(result.stages, "partition", [&](StageResult& stage) {
+        std::vector<WindowStats> stats;
+        windows = partitionByCones(circuit, graph, options.maxGates, options.maxInputs, stats);
+        stage.gates = circuit.size();
+    });
+    result.windows = windows.size();
+
+    // Encoding every window of a large circuit would write millions of
+    // files; an evenly spaced sample stands in for the whole stage.
+    runStage(result.stages, "encode", [&](StageResult& stage) {
+        std::ostream log(nullptr);
+        size_t count = std::min<size_t>(options.encodeWindows, windows.size());
+        for (size_t s = 0; s < count; ++s) {
+            const Circuit& window = windows[s * windows.size() / count];
+            encodeSubcircuitAsQBF(window, qbfFile, EncoderOptions(), log);
+            stage.gates += window.size();
+            stage.bytes += fileSize(qbfFile);
+        }
+    });
+
+    if (!options.keepFiles) {
+        std::remove(bristolFile.c_str());
+        std::remove(triStateFile.c_str());
+        std::remove(qbfFile.c_str());
+    }
+    return true;
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "{\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << (i ? "," : "") << "\n    {\"family\": \"" << r.family << "\", \"target_gates\": " << r.targetGates
+            << ", \"gates\": " << r.gates << ", \"wires\": " << r.wires
+            << ", \"tristate_gates\": " << r.triStateGates << ", \"windows\": " << r.windows
+            << ",\n     \"stages\": [";
+        for (size_t j = 0; j < r.stages.size(); ++j) {
+            const StageResult& s = r.stages[j];
+            double seconds = std::max(s.seconds, 1e-9);
+            out << (j ? "," : "") << "\n       {\"name\": \"" << s.name << "\", \"seconds\": " << s.seconds
+                << ", \"gates\": " << s.gates << ", \"gates_per_s\": " << s.gates / seconds
+                << ", \"bytes\": " << s.bytes << ", \"bytes_per_s\": " << s.bytes / seconds
+                << ", \"peak_rss_kb\": " << s.peakRssKb << "}";
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    std::vector<const Family*> families;
+    std::vector<long long> sizes;
+    std::string outFile;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--family" && i + 1 < argc) {
+            std::string name = argv[++i];
+            const Family* found = nullptr;
+            for (const Family& family : FAMILIES) {
+                if (name == family.name) {
+                    found = &family;
+                }
+            }
+            if (!found) {
+                std::cerr << "Unknown family: " << name << " (adder, multiplier, comparator, sbox)" << std::endl;
+                return 1;
+            }
+            families.push_back(found);
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while (std::getline(list, size, ',')) {
+                sizes.push_back(static_cast<long long>(std::atof(size.c_str())));
+            }
+        } else if (arg == "--encode-windows" && i + 1 < argc) {
+            options.encodeWindows = std::atoi(argv[++i]);
+        } else if (arg == "--max-gates" && i + 1 < argc) {
+            options.maxGates = std::atoi(argv[++i]);
+        } else if (arg == "--max-inputs" && i + 1 < argc) {
+            options.maxInputs = std::atoi(argv[++i]);
+        } else if (arg == "--dir" && i + 1 < argc) {
+            options.dir = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            outFile = argv[++i];
+        } else if (arg == "--keep") {
+            options.keepFiles = true;
+        } else {
+            std::cerr << "Usage: ./bench [--family adder|multiplier|comparator|sbox]... [--sizes 1e3,1e4,...]"
+                      << " [--encode-windows N] [--max-gates N] [--max-inputs N] [--dir DIR] [--out FILE] [--keep]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (families.empty()) {
+        for (const Family& family : FAMILIES) {
+            families.push_back(&family);
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {1000, 10000, 100000, 1000000};
+    }
+
+    std::vector<BenchResult> results;
+    for (const Family* family : families) {
+        for (long long size : sizes) {
+            BenchResult result;
+            if (!runBenchmark(*family, size, options, result)) {
+                return 1;
+            }
+            results.push_back(result);
+        }
+    }
+
+    if (outFile.empty()) {
+        writeJson(std::cout, results);
+        return 0;
+    }
+    std::ofstream out(outFile);
+    if (!out) {
+        std::cerr << "Failed to open output file: " << outFile << std::endl;
+        return 1;
+    }
+    writeJson(out, results);
+    return 0;
+}
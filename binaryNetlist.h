@@ -0,0 +1,74 @@
+#ifndef BINARY_NETLIST_H
+#define BINARY_NETLIST_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "netlist.h"
+
+// Binary netlist file, native byte order, every section 4-byte aligned:
+//
+//   BinaryNetlistHeader
+//   int32   inputWireCounts[niv]
+//   int32   outputWireCounts[nov]
+//   uint32  pinOffsets[2 * numGates + 1]   (same layout as FlatNetlist)
+//   int32   wires[numPins]
+//   uint8   opcodes[numGates]
+//
+// Plain Bristol and tristate circuits share the format; the opcodes tell them apart.
+const char BINARY_NETLIST_MAGIC[4] = {'B', 'N', 'L', '1'};
+
+struct BinaryNetlistHeader {
+    char magic[4];
+    int32_t numGates;
+    int32_t numWires;
+    int32_t niv;
+    int32_t nov;
+    uint32_t numPins;
+};
+
+inline bool isBinaryNetlist(const char* data, size_t size) {
+    return size >= sizeof(BinaryNetlistHeader) &&
+           std::memcmp(data, BINARY_NETLIST_MAGIC, sizeof(BINARY_NETLIST_MAGIC)) == 0;
+}
+
+// Byte size a file with this header must have.
+inline size_t binaryNetlistSize(const BinaryNetlistHeader& h) {
+    return sizeof(BinaryNetlistHeader) +
+           sizeof(int32_t) * (static_cast<size_t>(h.niv) + h.nov) +
+           sizeof(uint32_t) * (2 * static_cast<size_t>(h.numGates) + 1) +
+           sizeof(int32_t) * static_cast<size_t>(h.numPins) +
+           static_cast<size_t>(h.numGates);
+}
+
+inline bool writeBinaryNetlist(const std::string& filename, const FlatNetlist& netlist) {
+    FILE* out = std::fopen(filename.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Failed to open output file: " << filename << std::endl;
+        return false;
+    }
+    BinaryNetlistHeader h;
+    std::memcpy(h.magic, BINARY_NETLIST_MAGIC, sizeof(h.magic));
+    h.numGates = netlist.size();
+    h.numWires = netlist.numWires;
+    h.niv = static_cast<int32_t>(netlist.inputWireCounts.size());
+    h.nov = static_cast<int32_t>(netlist.outputWireCounts.size());
+    h.numPins = static_cast<uint32_t>(netlist.wires.size());
+
+    bool ok = std::fwrite(&h, sizeof(h), 1, out) == 1;
+    ok = ok && std::fwrite(netlist.inputWireCounts.data(), sizeof(int32_t), h.niv, out) == static_cast<size_t>(h.niv);
+    ok = ok && std::fwrite(netlist.outputWireCounts.data(), sizeof(int32_t), h.nov, out) == static_cast<size_t>(h.nov);
+    ok = ok && std::fwrite(netlist.pinOffsets.data(), sizeof(uint32_t), netlist.pinOffsets.size(), out) == netlist.pinOffsets.size();
+    ok = ok && std::fwrite(netlist.wires.data(), sizeof(int32_t), netlist.wires.size(), out) == netlist.wires.size();
+    ok = ok && std::fwrite(netlist.opcodes.data(), 1, netlist.opcodes.size(), out) == netlist.opcodes.size();
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error writing binary netlist: " << filename << std::endl;
+    }
+    return ok;
+}
+
+#endif
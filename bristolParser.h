@@ -0,0 +1,420 @@
+#ifndef BRISTOL_PARSER_H
+#define BRISTOL_PARSER_H
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "binaryNetlist.h"
+#include "decimal.h"
+#include "mappedFile.h"
+#include "netlist.h"
+#include "threadPool.h"
+
+// Reads a Bristol Fashion netlist (plain or tristate gate set) straight out of
+// a memory-mapped file, one gate at a time. Integers and mnemonics are parsed
+// in place; the only buffer is a pin scratch array sized by the widest gate.
+// Files in the binary netlist format are recognised by their magic and read
+// straight from the mapping instead.
+class BristolReader {
+public:
+    int numGates;
+    int numWires;
+    int niv;
+    int nov;
+    std::vector<int> inputWireCounts;
+    std::vector<int> outputWireCounts;
+
+    BristolReader() : numGates(0), numWires(0), niv(0), nov(0),
+                      cur_(nullptr), end_(nullptr), gatesRead_(0), failed_(false),
+                      binary_(false), numPins_(0), offsets_(nullptr), pinPool_(nullptr),
+                      ops_(nullptr) {}
+
+    bool open(const std::string& filename) {
+        if (!file_.open(filename)) {
+            std::cerr << "Failed to open the circuit file: " << filename << std::endl;
+            return false;
+        }
+        cur_ = file_.data();
+        end_ = cur_ + file_.size();
+        gatesRead_ = 0;
+
+        binary_ = isBinaryNetlist(file_.data(), file_.size());
+        if (binary_) {
+            return openBinary();
+        }
+
+        if (!readInt(numGates) || !readInt(numWires)) {
+            std::cerr << "Error reading number of gates and wires." << std::endl;
+            return false;
+        }
+        if (!readCounts(niv, inputWireCounts)) {
+            std::cerr << "Error reading input wire counts." << std::endl;
+            return false;
+        }
+        if (!readCounts(nov, outputWireCounts)) {
+            std::cerr << "Error reading output wire counts." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Returns false once all numGates gates have been read or on a parse error;
+    // failed() tells the two apart.
+    bool next(GateRecord& gate) {
+        if (gatesRead_ >= numGates) {
+            return false;
+        }
+        if (binary_) {
+            return nextBinary(gate);
+        }
+        int nIn, nOut;
+        if (!readInt(nIn) || !readInt(nOut) || nIn < 0 || nOut < 0 || nIn > INT_MAX - nOut) {
+            return fail("Error reading gate inputs and outputs.");
+        }
+        if (pins_.size() < static_cast<size_t>(nIn + nOut)) {
+            pins_.resize(nIn + nOut);
+        }
+        for (int j = 0; j < nIn + nOut; ++j) {
+            if (!readInt(pins_[j])) {
+                return fail(j < nIn ? "Error reading gate input wires."
+                                    : "Error reading gate output wires.");
+            }
+        }
+        skipSpace();
+        const char* name = cur_;
+        while (cur_ < end_ && !isSpace(*cur_)) {
+            ++cur_;
+        }
+        gate.opcode = opcodeFromMnemonic(name, cur_ - name);
+        if (gate.opcode == OP_INVALID) {
+            std::cerr << "Unsupported gate type: " << std::string(name, cur_ - name) << std::endl;
+            failed_ = true;
+            return false;
+        }
+        if (!pinsInRange(pins_.data(), nIn + nOut)) {
+            return false;
+        }
+        gate.numInputs = nIn;
+        gate.numOutputs = nOut;
+        gate.inputs = pins_.data();
+        gate.outputs = pins_.data() + nIn;
+        ++gatesRead_;
+        return true;
+    }
+
+    bool failed() const { return failed_; }
+    bool isBinary() const { return binary_; }
+
+    // Gates to reserve room for: numGates, but no more than a text file of
+    // this size can hold, so a corrupt header cannot force a huge allocation.
+    size_t gateCapacityHint() const {
+        return std::min(static_cast<size_t>(std::max(numGates, 0)), file_.size() / 8);
+    }
+
+    // Binary files only: copies the remaining sections into the netlist with
+    // one bulk copy per array.
+    bool copyBinary(FlatNetlist& netlist) {
+        size_t pinCount = 2 * static_cast<size_t>(numGates) + 1;
+        for (size_t i = 1; i < pinCount; ++i) {
+            if (offsets_[i] < offsets_[i - 1]) {
+                return fail("Corrupt pin offsets in binary netlist.");
+            }
+        }
+        if (offsets_[0] != 0 || offsets_[pinCount - 1] != numPins_) {
+            return fail("Corrupt pin offsets in binary netlist.");
+        }
+        for (int g = 0; g < numGates; ++g) {
+            if (ops_[g] >= OP_INVALID) {
+                return fail("Invalid opcode in binary netlist.");
+            }
+        }
+        for (gatesRead_ = 0; gatesRead_ < numGates; ++gatesRead_) {
+            uint32_t begin = offsets_[2 * gatesRead_];
+            if (!pinsInRange(pinPool_ + begin, offsets_[2 * gatesRead_ + 2] - begin)) {
+                return false;
+            }
+        }
+        netlist.opcodes.assign(ops_, ops_ + numGates);
+        netlist.pinOffsets.assign(offsets_, offsets_ + pinCount);
+        netlist.wires.assign(pinPool_, pinPool_ + numPins_);
+        gatesRead_ = numGates;
+        return true;
+    }
+
+private:
+    MappedFile file_;
+    const char* cur_;
+    const char* end_;
+    int gatesRead_;
+    bool failed_;
+    std::vector<int> pins_;
+
+    bool binary_;
+    uint32_t numPins_;
+    const uint32_t* offsets_;
+    const int* pinPool_;
+    const uint8_t* ops_;
+
+    bool openBinary() {
+        BinaryNetlistHeader h;
+        std::memcpy(&h, file_.data(), sizeof(h));
+        if (h.numGates < 0 || h.niv < 0 || h.nov < 0 || binaryNetlistSize(h) != file_.size()) {
+            std::cerr << "Truncated or corrupt binary netlist." << std::endl;
+            return false;
+        }
+        numGates = h.numGates;
+        numWires = h.numWires;
+        niv = h.niv;
+        nov = h.nov;
+        numPins_ = h.numPins;
+
+        const char* p = file_.data() + sizeof(h);
+        const int* counts = reinterpret_cast<const int*>(p);
+        inputWireCounts.assign(counts, counts + niv);
+        outputWireCounts.assign(counts + niv, counts + niv + nov);
+        p += sizeof(int32_t) * (niv + nov);
+        offsets_ = reinterpret_cast<const uint32_t*>(p);
+        p += sizeof(uint32_t) * (2 * static_cast<size_t>(numGates) + 1);
+        pinPool_ = reinterpret_cast<const int*>(p);
+        p += sizeof(int32_t) * static_cast<size_t>(numPins_);
+        ops_ = reinterpret_cast<const uint8_t*>(p);
+        return true;
+    }
+
+    bool nextBinary(GateRecord& gate) {
+        size_t g = gatesRead_;
+        uint32_t inBegin = offsets_[2 * g];
+        uint32_t outBegin = offsets_[2 * g + 1];
+        uint32_t outEnd = offsets_[2 * g + 2];
+        if (inBegin > outBegin || outBegin > outEnd || outEnd > numPins_) {
+            return fail("Corrupt pin offsets in binary netlist.");
+        }
+        if (ops_[g] >= OP_INVALID) {
+            return fail("Invalid opcode in binary netlist.");
+        }
+        if (!pinsInRange(pinPool_ + inBegin, outEnd - inBegin)) {
+            return false;
+        }
+        gate.opcode = ops_[g];
+        gate.numInputs = outBegin - inBegin;
+        gate.numOutputs = outEnd - outBegin;
+        gate.inputs = pinPool_ + inBegin;
+        gate.outputs = pinPool_ + outBegin;
+        ++gatesRead_;
+        return true;
+    }
+
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void skipSpace() {
+        while (cur_ < end_ && isSpace(*cur_)) {
+            ++cur_;
+        }
+    }
+
+    bool readInt(int& value) {
+        skipSpace();
+        bool negative = false;
+        if (cur_ < end_ && *cur_ == '-') {
+            negative = true;
+            ++cur_;
+        }
+        if (cur_ >= end_ || static_cast<unsigned>(*cur_ - '0') > 9) {
+            return false;
+        }
+        int v = 0;
+        while (cur_ < end_ && static_cast<unsigned>(*cur_ - '0') <= 9) {
+            int digit = *cur_ - '0';
+            if (v > (INT_MAX - digit) / 10) {
+                return false;
+            }
+            v = v * 10 + digit;
+            ++cur_;
+        }
+        value = negative ? -v : v;
+        return true;
+    }
+
+    bool readCounts(int& n, std::vector<int>& counts) {
+        if (!readInt(n) || n < 0) {
+            return false;
+        }
+        counts.resize(n);
+        for (int i = 0; i < n; ++i) {
+            if (!readInt(counts[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Every consumer indexes arrays by wire ID, so IDs outside
+    // [0, numWires) are rejected here rather than in each of them.
+    bool pinsInRange(const int* pins, size_t count) {
+        for (size_t j = 0; j < count; ++j) {
+            if (pins[j] < 0 || pins[j] >= numWires) {
+                std::cerr << "Wire ID out of range in gate " << gatesRead_ << std::endl;
+                failed_ = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool fail(const char* message) {
+        std::cerr << message << std::endl;
+        failed_ = true;
+        return false;
+    }
+};
+
+// Parses a whole Bristol Fashion file into a flat netlist.
+inline bool readBristol(const std::string& filename, FlatNetlist& netlist) {
+    BristolReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+    netlist.numGates = reader.numGates;
+    netlist.numWires = reader.numWires;
+    netlist.inputWireCounts = reader.inputWireCounts;
+    netlist.outputWireCounts = reader.outputWireCounts;
+    if (reader.isBinary()) {
+        return reader.copyBinary(netlist);
+    }
+    netlist.reserve(reader.gateCapacityHint(), 3 * reader.gateCapacityHint());
+
+    GateRecord gate;
+    while (reader.next(gate)) {
+        netlist.addGate(gate);
+    }
+    return !reader.failed();
+}
+
+// Writes the three Bristol header lines.
+inline void writeBristolHeader(std::ostream& out, long long numGates, long long numWires,
+                               const std::vector<int>& inputWireCounts,
+                               const std::vector<int>& outputWireCounts) {
+    out << numGates << " " << numWires << "\n";
+    out << inputWireCounts.size();
+    for (int count : inputWireCounts) {
+        out << " " << count;
+    }
+    out << "\n" << outputWireCounts.size();
+    for (int count : outputWireCounts) {
+        out << " " << count;
+    }
+    out << "\n";
+}
+
+// Longest line formatBristolGate can produce for gate.
+inline size_t maxBristolGateLength(const GateRecord& gate) {
+    return 21 * (2 + static_cast<size_t>(gate.numInputs) + gate.numOutputs) + 16;
+}
+
+// Formats one gate line at out and returns the end.
+inline char* formatBristolGate(char* out, const GateRecord& gate) {
+    out = formatDecimal(out, gate.numInputs);
+    *out++ = ' ';
+    out = formatDecimal(out, gate.numOutputs);
+    for (int j = 0; j < gate.numInputs; ++j) {
+        *out++ = ' ';
+        out = formatDecimal(out, gate.inputs[j]);
+    }
+    for (int j = 0; j < gate.numOutputs; ++j) {
+        *out++ = ' ';
+        out = formatDecimal(out, gate.outputs[j]);
+    }
+    *out++ = ' ';
+    const char* name = opcodeName(gate.opcode);
+    size_t len = std::strlen(name);
+    std::memcpy(out, name, len);
+    out += len;
+    *out++ = '\n';
+    return out;
+}
+
+inline void writeBristolGate(std::ostream& out, const GateRecord& gate) {
+    char line[256];
+    if (maxBristolGateLength(gate) <= sizeof(line)) {
+        out.write(line, formatBristolGate(line, gate) - line);
+        return;
+    }
+    std::vector<char> wide(maxBristolGateLength(gate));
+    out.write(wide.data(), formatBristolGate(wide.data(), gate) - wide.data());
+}
+
+inline bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Writes a flat netlist back out as Bristol Fashion text. Gates are
+// formatted in chunks on numThreads workers (0 = all cores), a batch of
+// chunks at a time so memory stays bounded, and each batch goes out in
+// order with one write() per chunk.
+inline bool writeBristol(const std::string& filename, const FlatNetlist& netlist, unsigned numThreads = 0) {
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open output file: " << filename << std::endl;
+        return false;
+    }
+    std::ostringstream header;
+    writeBristolHeader(header, netlist.size(), netlist.numWires,
+                       netlist.inputWireCounts, netlist.outputWireCounts);
+    bool ok = writeAll(fd, header.str().data(), header.str().size());
+
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const int chunkGates = 1 << 15;
+    int numChunks = (netlist.size() + chunkGates - 1) / chunkGates;
+    int batchChunks = 4 * static_cast<int>(numThreads);
+    std::vector<std::vector<char>> buffers(std::min(batchChunks, numChunks));
+    std::vector<size_t> used(buffers.size());
+    for (int first = 0; first < numChunks && ok; first += batchChunks) {
+        int count = std::min(batchChunks, numChunks - first);
+        parallelFor(count, numThreads, [&](int i) {
+            int begin = (first + i) * chunkGates;
+            int end = std::min(netlist.size(), begin + chunkGates);
+            size_t pins = netlist.pinOffsets[2 * end] - netlist.pinOffsets[2 * begin];
+            size_t bound = 21 * (2 * static_cast<size_t>(end - begin) + pins) + 16 * static_cast<size_t>(end - begin);
+            if (buffers[i].size() < bound) {
+                buffers[i].resize(bound);
+            }
+            char* out = buffers[i].data();
+            for (int g = begin; g < end; ++g) {
+                out = formatBristolGate(out, netlist.gate(g));
+            }
+            used[i] = out - buffers[i].data();
+        });
+        for (int i = 0; i < count && ok; ++i) {
+            ok = writeAll(fd, buffers[i].data(), used[i]);
+        }
+    }
+    ok = (::close(fd) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error writing output file: " << filename << std::endl;
+    }
+    return ok;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef BRISTOL_SIM_H
+#define BRISTOL_SIM_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "netlist.h"
+
+// Bit-sliced evaluator for plain Bristol Fashion netlists, Words x 64 input
+// vectors per pass. EQ follows the Bristol Fashion definition: its single
+// "input" is the constant 0 or 1 to assign, while EQW copies a wire.
+template <int Words = 4>
+class BristolSimulator {
+public:
+    static const int LANES = 64 * Words;
+
+    BristolSimulator() : netlist_(nullptr) {}
+
+    bool compile(const FlatNetlist& netlist) {
+        for (int g = 0; g < netlist.size(); ++g) {
+            int nIn = netlist.numInputs(g);
+            int nOut = netlist.numOutputs(g);
+            bool ok;
+            switch (netlist.opcodes[g]) {
+                case OP_XOR:
+                case OP_AND:  ok = nIn == 2 && nOut == 1; break;
+                case OP_INV:
+                case OP_EQ:
+                case OP_EQW:  ok = nIn == 1 && nOut == 1; break;
+                case OP_MAND: ok = nIn % 2 == 0 && nOut == nIn / 2; break;
+                default:      ok = false; break;
+            }
+            if (!ok) {
+                std::cerr << "Unsupported Bristol gate " << g << ": " << opcodeName(netlist.opcodes[g])
+                          << " with " << nIn << " inputs and " << nOut << " outputs" << std::endl;
+                return false;
+            }
+            for (int j = 0; j < nIn + nOut; ++j) {
+                int wire = netlist.inputs(g)[j];
+                bool constant = netlist.opcodes[g] == OP_EQ && j == 0;
+                if (!constant && (wire < 0 || wire >= netlist.numWires)) {
+                    std::cerr << "Wire ID out of range in gate " << g << std::endl;
+                    return false;
+                }
+            }
+        }
+        netlist_ = &netlist;
+        values_.assign(static_cast<size_t>(netlist.numWires) * Words, 0);
+        return true;
+    }
+
+    void setBinary(int wire, const uint64_t* bits) {
+        for (int k = 0; k < Words; ++k) {
+            values_[static_cast<size_t>(wire) * Words + k] = bits[k];
+        }
+    }
+
+    const uint64_t* value(int wire) const { return &values_[static_cast<size_t>(wire) * Words]; }
+
+    void run() {
+        const FlatNetlist& n = *netlist_;
+        for (int g = 0; g < n.size(); ++g) {
+            const int* in = n.inputs(g);
+            const int* out = n.outputs(g);
+            uint64_t* o = wire(out[0]);
+            switch (n.opcodes[g]) {
+                case OP_XOR: {
+                    const uint64_t* a = wire(in[0]);
+                    const uint64_t* b = wire(in[1]);
+                    for (int k = 0; k < Words; ++k) {
+                        o[k] = a[k] ^ b[k];
+                    }
+                    break;
+                }
+                case OP_AND: {
+                    const uint64_t* a = wire(in[0]);
+                    const uint64_t* b = wire(in[1]);
+                    for (int k = 0; k < Words; ++k) {
+                        o[k] = a[k] & b[k];
+                    }
+                    break;
+                }
+                case OP_INV: {
+                    const uint64_t* a = wire(in[0]);
+                    for (int k = 0; k < Words; ++k) {
+                        o[k] = ~a[k];
+                    }
+                    break;
+                }
+                case OP_EQ:
+                    for (int k = 0; k < Words; ++k) {
+                        o[k] = in[0] ? ~0ULL : 0;
+                    }
+                    break;
+                case OP_EQW: {
+                    const uint64_t* a = wire(in[0]);
+                    for (int k = 0; k < Words; ++k) {
+                        o[k] = a[k];
+                    }
+                    break;
+                }
+                case OP_MAND: {
+                    int lanes = n.numOutputs(g);
+                    for (int i = 0; i < lanes; ++i) {
+                        uint64_t* oi = wire(out[i]);
+                        const uint64_t* a = wire(in[i]);
+                        const uint64_t* b = wire(in[i + lanes]);
+                        for (int k = 0; k < Words; ++k) {
+                            oi[k] = a[k] & b[k];
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    const FlatNetlist* netlist_;
+    std::vector<uint64_t> values_;
+
+    uint64_t* wire(int w) { return &values_[static_cast<size_t>(w) * Words]; }
+};
+
+#endif
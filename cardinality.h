@@ -0,0 +1,157 @@
+#ifndef CARDINALITY_H
+#define CARDINALITY_H
+
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// At-most-one encodings. Auxiliary variables are taken from nextAuxVar, which
+// the caller reserves up front (see atMostOneCost) so they can be quantified.
+//
+//   pairwise:   0 aux vars,        n(n-1)/2 clauses
+//   sequential: n-1 aux vars,      3n-4 clauses (Sinz ladder)
+//   commander:  ~n/2 aux vars,     ~3.5n clauses (groups of 3, recursive)
+//   product:    ~2 sqrt(n) vars,   ~2n + 4 sqrt(n) clauses (Chen, recursive)
+enum AmoEncoding { AMO_AUTO, AMO_PAIRWISE, AMO_SEQUENTIAL, AMO_COMMANDER, AMO_PRODUCT };
+
+inline const char* amoEncodingName(AmoEncoding encoding) {
+    switch (encoding) {
+        case AMO_AUTO:       return "auto";
+        case AMO_PAIRWISE:   return "pairwise";
+        case AMO_SEQUENTIAL: return "sequential";
+        case AMO_COMMANDER:  return "commander";
+        case AMO_PRODUCT:    return "product";
+    }
+    return "unknown";
+}
+
+inline bool parseAmoEncoding(const std::string& name, AmoEncoding& encoding) {
+    for (int e = AMO_AUTO; e <= AMO_PRODUCT; ++e) {
+        if (name == amoEncodingName(static_cast<AmoEncoding>(e))) {
+            encoding = static_cast<AmoEncoding>(e);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pairwise is smallest up to 6 variables; the sequential ladder propagates
+// as well as pairwise and stays linear; the product encoding needs the
+// fewest auxiliary variables once groups get large.
+inline AmoEncoding resolveAmoEncoding(AmoEncoding encoding, size_t n) {
+    if (encoding != AMO_AUTO) {
+        return encoding;
+    }
+    if (n <= 6) {
+        return AMO_PAIRWISE;
+    }
+    return n <= 128 ? AMO_SEQUENTIAL : AMO_PRODUCT;
+}
+
+// Clause sink that only counts, for sizing encodings before emitting them.
+struct ClauseCounter {
+    long long clauses = 0;
+
+    void lit(int) {}
+    void end() { ++clauses; }
+    void clause(std::initializer_list<int>) { ++clauses; }
+};
+
+template <class Sink>
+void addAtMostOne(const std::vector<int>& vars, AmoEncoding encoding, int& nextAuxVar, Sink& sink) {
+    size_t n = vars.size();
+    if (n <= 1) {
+        return;
+    }
+    encoding = resolveAmoEncoding(encoding, n);
+    if (n <= 2) {
+        encoding = AMO_PAIRWISE;
+    }
+
+    if (encoding == AMO_PAIRWISE) {
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                sink.clause({-vars[i], -vars[j]});
+            }
+        }
+    } else if (encoding == AMO_SEQUENTIAL) {
+        // s_i: some of x_0..x_i is true
+        int s = nextAuxVar;
+        nextAuxVar += static_cast<int>(n) - 1;
+        sink.clause({-vars[0], s});
+        for (size_t i = 1; i + 1 < n; ++i) {
+            int si = s + static_cast<int>(i);
+            sink.clause({-vars[i], si});
+            sink.clause({-(si - 1), si});
+            sink.clause({-vars[i], -(si - 1)});
+        }
+        sink.clause({-vars[n - 1], -(s + static_cast<int>(n) - 2)});
+    } else if (encoding == AMO_COMMANDER) {
+        if (n <= 6) {
+            addAtMostOne(vars, AMO_PAIRWISE, nextAuxVar, sink);
+            return;
+        }
+        std::vector<int> commanders;
+        for (size_t begin = 0; begin < n; begin += 3) {
+            size_t end = begin + 3 < n ? begin + 3 : n;
+            int c = nextAuxVar++;
+            commanders.push_back(c);
+            // c <-> OR(group), and at most one inside the group
+            sink.lit(-c);
+            for (size_t i = begin; i < end; ++i) {
+                sink.lit(vars[i]);
+            }
+            sink.end();
+            for (size_t i = begin; i < end; ++i) {
+                sink.clause({-vars[i], c});
+                for (size_t j = i + 1; j < end; ++j) {
+                    sink.clause({-vars[i], -vars[j]});
+                }
+            }
+        }
+        addAtMostOne(commanders, AMO_COMMANDER, nextAuxVar, sink);
+    } else {
+        // x_k sits at (k / q, k % q) of a p x q grid; at most one row and one column
+        size_t p = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+        size_t q = (n + p - 1) / p;
+        std::vector<int> rows, cols;
+        for (size_t i = 0; i < p; ++i) {
+            rows.push_back(nextAuxVar++);
+        }
+        for (size_t j = 0; j < q; ++j) {
+            cols.push_back(nextAuxVar++);
+        }
+        for (size_t k = 0; k < n; ++k) {
+            sink.clause({-vars[k], rows[k / q]});
+            sink.clause({-vars[k], cols[k % q]});
+        }
+        AmoEncoding inner = rows.size() <= 6 ? AMO_PAIRWISE : AMO_PRODUCT;
+        addAtMostOne(rows, inner, nextAuxVar, sink);
+        inner = cols.size() <= 6 ? AMO_PAIRWISE : AMO_PRODUCT;
+        addAtMostOne(cols, inner, nextAuxVar, sink);
+    }
+}
+
+struct AmoCost {
+    int auxVars;
+    long long clauses;
+};
+
+// Auxiliary variables and clauses addAtMostOne uses for n variables.
+inline AmoCost atMostOneCost(size_t n, AmoEncoding encoding) {
+    std::vector<int> vars(n);
+    for (size_t i = 0; i < n; ++i) {
+        vars[i] = static_cast<int>(i) + 1;
+    }
+    int nextAuxVar = static_cast<int>(n) + 1;
+    ClauseCounter counter;
+    addAtMostOne(vars, encoding, nextAuxVar, counter);
+    AmoCost cost;
+    cost.auxVars = nextAuxVar - static_cast<int>(n) - 1;
+    cost.clauses = counter.clauses;
+    return cost;
+}
+
+#endif
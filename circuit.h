@@ -0,0 +1,235 @@
+#ifndef CIRCUIT_H
+#define CIRCUIT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bristolParser.h"
+
+// One tristate gate as seen by the passes below; missing inputs are -1.
+struct Gate {
+    uint8_t type; // Opcode
+    int input1;
+    int input2;
+    int output;
+};
+
+// Circuit structure. Gates live in a flat netlist of single-output tristate
+// gates, which also keeps the header of the file the circuit was read from.
+struct Circuit {
+    int numInputs;
+    int numOutputs;
+    FlatNetlist netlist;
+    std::vector<int> inputWires;  
+    std::vector<int> outputWires;
+
+    int size() const { return netlist.size(); }
+
+    Gate gate(int g) const {
+        Gate gate;
+        gate.type = netlist.opcodes[g];
+        gate.input1 = netlist.numInputs(g) > 0 ? netlist.inputs(g)[0] : -1;
+        gate.input2 = netlist.numInputs(g) > 1 ? netlist.inputs(g)[1] : -1;
+        gate.output = netlist.outputs(g)[0];
+        return gate;
+    }
+
+    void addGate(const Gate& gate) {
+        int in[2];
+        int nIn = 0;
+        for (int wire : {gate.input1, gate.input2}) {
+            if (wire >= 0) {
+                in[nIn++] = wire;
+            }
+        }
+        netlist.addGate(gate.type, in, nIn, &gate.output, 1);
+    }
+};
+
+inline bool isTriStateOpcode(uint8_t op) {
+    return op == OP_JOIN || op == OP_BUFFER || op == OP_XOR || op == OP_CONST_ZERO || op == OP_CONST_ONE;
+}
+
+inline Circuit readCircuit(const std::string& filename) {
+    BristolReader reader;
+    if (!reader.open(filename)) {
+        exit(1);
+    }
+
+    Circuit circuit;
+    int totalInputWires = 0;
+    for (int ni : reader.inputWireCounts) {
+        totalInputWires += ni;
+    }
+    int totalOutputWires = 0;
+    for (int no : reader.outputWireCounts) {
+        totalOutputWires += no;
+    }
+
+    int wireIndex = 0;
+
+    circuit.numInputs = totalInputWires;
+    for (int i = 0; i < totalInputWires; ++i) {
+        circuit.inputWires.push_back(wireIndex++);
+    }
+
+    FlatNetlist& netlist = circuit.netlist;
+    netlist.reserve(reader.gateCapacityHint(), 3 * reader.gateCapacityHint());
+    GateRecord record;
+    while (reader.next(record)) {
+        if (!isTriStateOpcode(record.opcode)) {
+            std::cerr << "Unknown gate type: " << opcodeName(record.opcode) << std::endl;
+            continue;
+        }
+        // multi-output gates are split, each output reading the first two inputs
+        int nIn = std::min(record.numInputs, 2);
+        for (int j = 0; j < record.numOutputs; ++j) {
+            netlist.addGate(record.opcode, record.inputs, nIn, record.outputs + j, 1);
+        }
+    }
+    if (reader.failed()) {
+        exit(1);
+    }
+
+    netlist.numGates = netlist.size();
+    netlist.numWires = reader.numWires;
+    netlist.inputWireCounts = reader.inputWireCounts;
+    netlist.outputWireCounts = reader.outputWireCounts;
+    circuit.numOutputs = totalOutputWires;
+    for (int i = reader.numWires - totalOutputWires; i < reader.numWires; ++i) {
+        circuit.outputWires.push_back(i);
+    }
+
+    return circuit;
+}
+
+
+// Fanout index over a circuit, keyed directly by wire ID. The consumers of
+// wire w are fanoutGates[fanoutStart[w] .. fanoutStart[w + 1]). Built once
+// and shared by every pass that needs ordering, depth or fanout.
+struct CircuitGraph {
+    int numWires;
+    std::vector<int> driver;       // gate driving each wire, -1 for primary inputs
+    std::vector<char> primaryOutput;
+    std::vector<int> fanoutStart;
+    std::vector<int> fanoutGates;
+    std::vector<int> topoOrder;    // gate indices in Kahn order
+    std::vector<int> level;        // per gate: 0 if fed only by primary inputs
+    int depth;
+
+    const int* fanoutBegin(int wire) const { return fanoutGates.data() + fanoutStart[wire]; }
+    const int* fanoutEnd(int wire) const { return fanoutGates.data() + fanoutStart[wire + 1]; }
+    int fanout(int wire) const { return fanoutStart[wire + 1] - fanoutStart[wire]; }
+};
+
+// Works on any flat netlist, so the tristate passes in transform.h share it
+// with the partitioner; every input and output pin of a gate counts. Fails
+// if a wire ID falls outside [0, netlist.numWires).
+inline bool buildCircuitGraph(const FlatNetlist& netlist, const std::vector<int>& inputWires,
+                              const std::vector<int>& outputWires, CircuitGraph& graph) {
+    int numGates = netlist.size();
+    graph.numWires = netlist.numWires;
+    auto outOfRange = [&](int wire) { return wire < 0 || wire >= graph.numWires; };
+    for (int wire : inputWires) {
+        if (outOfRange(wire)) {
+            std::cerr << "Input wire " << wire << " out of range" << std::endl;
+            return false;
+        }
+    }
+    for (int wire : outputWires) {
+        if (outOfRange(wire)) {
+            std::cerr << "Output wire " << wire << " out of range" << std::endl;
+            return false;
+        }
+    }
+    for (int g = 0; g < numGates; ++g) {
+        for (uint32_t p = netlist.pinOffsets[2 * g]; p < netlist.pinOffsets[2 * g + 2]; ++p) {
+            if (outOfRange(netlist.wires[p])) {
+                std::cerr << "Wire ID out of range in gate " << g << std::endl;
+                return false;
+            }
+        }
+    }
+
+    graph.driver.assign(graph.numWires, -1);
+    graph.primaryOutput.assign(graph.numWires, 0);
+    for (int wire : outputWires) {
+        graph.primaryOutput[wire] = 1;
+    }
+    for (int g = 0; g < numGates; ++g) {
+        for (int j = 0; j < netlist.numOutputs(g); ++j) {
+            graph.driver[netlist.outputs(g)[j]] = g;
+        }
+    }
+
+    // Counting sort of (input wire, gate) pairs into CSR form
+    graph.fanoutStart.assign(graph.numWires + 1, 0);
+    for (int g = 0; g < numGates; ++g) {
+        for (int j = 0; j < netlist.numInputs(g); ++j) {
+            graph.fanoutStart[netlist.inputs(g)[j] + 1]++;
+        }
+    }
+    for (int w = 0; w < graph.numWires; ++w) {
+        graph.fanoutStart[w + 1] += graph.fanoutStart[w];
+    }
+    graph.fanoutGates.resize(graph.fanoutStart[graph.numWires]);
+    std::vector<int> fill(graph.fanoutStart.begin(), graph.fanoutStart.end() - 1);
+    for (int g = 0; g < numGates; ++g) {
+        for (int j = 0; j < netlist.numInputs(g); ++j) {
+            graph.fanoutGates[fill[netlist.inputs(g)[j]]++] = g;
+        }
+    }
+
+    // Kahn's algorithm over gates: a gate is ready once every gate-driven
+    // input is placed. The order vector doubles as the queue.
+    std::vector<int> pending(numGates, 0);
+    for (int g = 0; g < numGates; ++g) {
+        for (int j = 0; j < netlist.numInputs(g); ++j) {
+            if (graph.driver[netlist.inputs(g)[j]] >= 0) {
+                pending[g]++;
+            }
+        }
+    }
+    graph.topoOrder.clear();
+    graph.topoOrder.reserve(numGates);
+    graph.level.assign(numGates, 0);
+    for (int g = 0; g < numGates; ++g) {
+        if (pending[g] == 0) {
+            graph.topoOrder.push_back(g);
+        }
+    }
+    graph.depth = 0;
+    for (size_t head = 0; head < graph.topoOrder.size(); ++head) {
+        int g = graph.topoOrder[head];
+        int next = graph.level[g] + 1;
+        graph.depth = std::max(graph.depth, next);
+        for (int j = 0; j < netlist.numOutputs(g); ++j) {
+            int out = netlist.outputs(g)[j];
+            for (const int* it = graph.fanoutBegin(out); it != graph.fanoutEnd(out); ++it) {
+                graph.level[*it] = std::max(graph.level[*it], next);
+                if (--pending[*it] == 0) {
+                    graph.topoOrder.push_back(*it);
+                }
+            }
+        }
+    }
+    if (static_cast<int>(graph.topoOrder.size()) != numGates) {
+        std::cerr << "Warning: circuit has a cycle, " << numGates - graph.topoOrder.size()
+                  << " gates left unordered" << std::endl;
+    }
+    return true;
+}
+
+inline bool buildCircuitGraph(const Circuit& circuit, CircuitGraph& graph) {
+    return buildCircuitGraph(circuit.netlist, circuit.inputWires, circuit.outputWires, graph);
+}
+
+inline bool writeCircuit(const std::string& filename, const Circuit& circuit) {
+    return writeBristol(filename, circuit.netlist);
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef CLAUSE_SINK_H
+#define CLAUSE_SINK_H
+
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "decimal.h"
+
+// Streams a (Q)DIMACS file through one large buffer. Literals are formatted
+// straight into the buffer, so memory does not grow with the clause count.
+// The "p cnf" line is written with a fixed-width, right-aligned clause count
+// field that close() overwrites in place once the final count is known.
+class ClauseSink {
+public:
+    ClauseSink() : fd_(-1), used_(0), clauses_(0), countOffset_(-1), written_(0), ok_(true) {
+        buffer_.resize(BUFFER_SIZE);
+    }
+    ~ClauseSink() { close(); }
+
+    ClauseSink(const ClauseSink&) = delete;
+    ClauseSink& operator=(const ClauseSink&) = delete;
+
+    bool open(const std::string& filename) {
+        fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd_ >= 0;
+    }
+
+    void header(int numVars) {
+        text("p cnf ");
+        number(numVars);
+        put(' ');
+        countOffset_ = written_ + static_cast<long long>(used_);
+        for (int i = 0; i < COUNT_WIDTH; ++i) {
+            put(' ');
+        }
+        put('\n');
+    }
+
+    void text(const char* s) {
+        size_t len = std::strlen(s);
+        reserve(len);
+        std::memcpy(&buffer_[used_], s, len);
+        used_ += len;
+    }
+
+    void put(char c) {
+        reserve(1);
+        buffer_[used_++] = c;
+    }
+
+    // Writes a signed integer followed by a space.
+    void number(long long value) {
+        reserve(MAX_NUMBER);
+        char* out = formatDecimal(&buffer_[used_], value);
+        *out++ = ' ';
+        used_ = out - buffer_.data();
+    }
+
+    void lit(int literal) { number(literal); }
+
+    void end() {
+        text("0\n");
+        ++clauses_;
+    }
+
+    // 0 terminates clauses in DIMACS, so zero literals are skipped; callers
+    // use that for optional guard literals.
+    void clause(std::initializer_list<int> literals) {
+        for (int literal : literals) {
+            if (literal != 0) {
+                lit(literal);
+            }
+        }
+        end();
+    }
+
+    long long numClauses() const { return clauses_; }
+
+    // Flushes the buffer and patches the clause count into the header.
+    bool close() {
+        if (fd_ < 0) {
+            return ok_;
+        }
+        flush();
+        if (countOffset_ >= 0) {
+            std::string count = std::to_string(clauses_);
+            std::string field(COUNT_WIDTH - count.size(), ' ');
+            field += count;
+            ok_ = ok_ && pwrite(fd_, field.data(), field.size(), countOffset_) ==
+                             static_cast<ssize_t>(field.size());
+        }
+        ok_ = (::close(fd_) == 0) && ok_;
+        fd_ = -1;
+        return ok_;
+    }
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    static const size_t MAX_NUMBER = 24;
+    static const int COUNT_WIDTH = 20;
+
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_;
+    long long clauses_;
+    long long countOffset_;
+    long long written_;
+    bool ok_;
+
+    void reserve(size_t len) {
+        if (used_ + len > buffer_.size()) {
+            flush();
+            if (len > buffer_.size()) {
+                buffer_.resize(len);
+            }
+        }
+    }
+
+    void flush() {
+        size_t done = 0;
+        while (done < used_) {
+            ssize_t n = ::write(fd_, buffer_.data() + done, used_ - done);
+            if (n <= 0) {
+                ok_ = false;
+                break;
+            }
+            done += n;
+        }
+        written_ += used_;
+        used_ = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <string>
+
+#include "bristolParser.h"
+
+// Converts a netlist between Bristol Fashion text and the binary netlist
+// format. The direction follows the input: text becomes binary and binary
+// becomes text.
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: ./convert_circuit <input_circuit_file> <output_file>" << std::endl;
+        return 1;
+    }
+
+    BristolReader probe;
+    if (!probe.open(argv[1])) {
+        return 1;
+    }
+    bool toText = probe.isBinary();
+
+    FlatNetlist netlist;
+    if (!readBristol(argv[1], netlist)) {
+        return 1;
+    }
+
+    bool ok = toText ? writeBristol(argv[2], netlist) : writeBinaryNetlist(argv[2], netlist);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes value in decimal at out, two digits per step from the end, and
+// returns the end. At most 20 characters are written.
+inline char* formatDecimal(char* out, long long value) {
+    unsigned long long v = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : value;
+    if (value < 0) {
+        *out++ = '-';
+    }
+    int length = 1;
+    for (unsigned long long bound = 10; length < 20 && v >= bound; bound *= 10) {
+        ++length;
+    }
+    char* end = out + length;
+    char* p = end;
+    while (v >= 100) {
+        unsigned pair = static_cast<unsigned>(v % 100) * 2;
+        v /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    if (v >= 10) {
+        *--p = DIGIT_PAIRS[v * 2 + 1];
+        *--p = DIGIT_PAIRS[v * 2];
+    } else {
+        *--p = static_cast<char>('0' + v);
+    }
+    return end;
+}
+
+#endif
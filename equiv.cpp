@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bristolParser.h"
+#include "bristolSim.h"
+#include "triStateSim.h"
+
+// Random-simulation equivalence check between a Bristol netlist and its
+// tristate lowering. transformCircuit keeps every original wire ID and only
+// appends helper wires, so inputs and outputs are compared at the same IDs.
+// With --outputs-last (for ./main --renumber) the tristate outputs are its
+// last wires instead, in the same order.
+
+struct Mismatch {
+    long long batch;
+    int lane;
+    int output;
+    int expected;
+    int actual;
+    std::vector<char> inputs;
+};
+
+static const char* stateName(int state) {
+    static const char* names[] = {"0", "1", "Z", "X"};
+    return names[state & 3];
+}
+
+int main(int argc, char* argv[]) {
+    long long numVectors = 1 << 20;
+    unsigned numThreads = std::thread::hardware_concurrency();
+    uint64_t seed = 1;
+    bool outputsLast = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--vectors" && i + 1 < argc) {
+            numVectors = std::atoll(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--outputs-last") {
+            outputsLast = true;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2) {
+        std::cerr << "Usage: ./equiv [--vectors N] [--threads T] [--seed S] [--outputs-last] <bristol_circuit_file> <tristate_circuit_file>" << std::endl;
+        return 1;
+    }
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+
+    FlatNetlist bristol, triState;
+    if (!readBristol(files[0], bristol) || !readBristol(files[1], triState)) {
+        return 1;
+    }
+    int numInputs = 0, numOutputs = 0;
+    for (int count : bristol.inputWireCounts) {
+        numInputs += count;
+    }
+    for (int count : bristol.outputWireCounts) {
+        numOutputs += count;
+    }
+    int triInputs = 0;
+    for (int count : triState.inputWireCounts) {
+        triInputs += count;
+    }
+    int triOutputBegin = outputsLast ? triState.numWires - numOutputs : bristol.numWires - numOutputs;
+    if (triInputs != numInputs || triOutputBegin < numInputs ||
+        (!outputsLast && triState.numWires < bristol.numWires)) {
+        std::cerr << "Circuits do not have matching inputs and outputs." << std::endl;
+        return 1;
+    }
+    std::vector<int> outputWires, triOutputWires;
+    for (int o = 0; o < numOutputs; ++o) {
+        outputWires.push_back(bristol.numWires - numOutputs + o);
+        triOutputWires.push_back(triOutputBegin + o);
+    }
+
+    typedef BristolSimulator<4> RefSim;
+    typedef TriStateSimulator<4> TriSim;
+    {
+        RefSim ref;
+        TriSim tri;
+        if (!ref.compile(bristol) || !tri.compile(triState)) {
+            return 1;
+        }
+    }
+
+    long long numBatches = (numVectors + TriSim::LANES - 1) / TriSim::LANES;
+    std::atomic<long long> nextBatch(0);
+    std::atomic<long long> firstBadBatch(numBatches);
+    std::mutex mismatchLock;
+    Mismatch mismatch;
+
+    auto worker = [&]() {
+        RefSim ref;
+        TriSim tri;
+        ref.compile(bristol);
+        tri.compile(triState);
+        uint64_t bits[4];
+        for (;;) {
+            long long batch = nextBatch++;
+            if (batch >= firstBadBatch.load()) {
+                break;
+            }
+            SplitMix64 rng(seed * 0x9E3779B97F4A7C15ULL + batch);
+            for (int w = 0; w < numInputs; ++w) {
+                for (int k = 0; k < 4; ++k) {
+                    bits[k] = rng.next();
+                }
+                ref.setBinary(w, bits);
+                tri.setBinary(w, bits);
+            }
+            ref.run();
+            tri.run();
+
+            for (int o = 0; o < numOutputs; ++o) {
+                const uint64_t* expected = ref.value(outputWires[o]);
+                const uint64_t* hi = tri.hi(triOutputWires[o]);
+                const uint64_t* lo = tri.lo(triOutputWires[o]);
+                for (int k = 0; k < 4; ++k) {
+                    uint64_t diff = hi[k] | (lo[k] ^ expected[k]);
+                    if (!diff) {
+                        continue;
+                    }
+                    int lane = 64 * k + __builtin_ctzll(diff);
+                    std::lock_guard<std::mutex> guard(mismatchLock);
+                    if (batch < firstBadBatch.load()) {
+                        firstBadBatch = batch;
+                        mismatch.batch = batch;
+                        mismatch.lane = lane;
+                        mismatch.output = o;
+                        mismatch.expected = (expected[k] >> (lane % 64)) & 1;
+                        mismatch.actual = static_cast<int>(((hi[k] >> (lane % 64)) & 1) << 1 |
+                                                           ((lo[k] >> (lane % 64)) & 1));
+                        mismatch.inputs.resize(numInputs);
+                        for (int w = 0; w < numInputs; ++w) {
+                            mismatch.inputs[w] = (ref.value(w)[k] >> (lane % 64)) & 1;
+                        }
+                    }
+                    break;
+                }
+                if (batch >= firstBadBatch.load()) {
+                    break;
+                }
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < numThreads; ++t) {
+        threads.push_back(std::thread(worker));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (firstBadBatch.load() < numBatches) {
+        std::cout << "NOT EQUIVALENT: output bit " << mismatch.output << " (wire "
+                  << outputWires[mismatch.output] << ") expected " << stateName(mismatch.expected)
+                  << ", got " << stateName(mismatch.actual) << std::endl;
+        std::cout << "Input vector (wire 0 first): ";
+        for (char bit : mismatch.inputs) {
+            std::cout << static_cast<int>(bit);
+        }
+        std::cout << std::endl;
+        return 2;
+    }
+    long long checked = numBatches * TriSim::LANES;
+    std::cout << "EQUIVALENT on " << checked << " random vectors (" << numThreads << " threads, "
+              << seconds << " s, " << checked / seconds * 60 << " vectors/min)" << std::endl;
+    return 0;
+}
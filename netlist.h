@@ -0,0 +1,131 @@
+#ifndef NETLIST_H
+#define NETLIST_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Gate opcodes shared by Bristol Fashion and tristate netlists.
+enum Opcode : uint8_t {
+    OP_XOR,
+    OP_AND,
+    OP_INV,
+    OP_EQ,
+    OP_EQW,
+    OP_MAND,
+    OP_JOIN,
+    OP_BUFFER,
+    OP_CONST_ZERO,
+    OP_CONST_ONE,
+    OP_INVALID
+};
+
+inline const char* opcodeName(uint8_t op) {
+    switch (op) {
+        case OP_XOR:        return "XOR";
+        case OP_AND:        return "AND";
+        case OP_INV:        return "INV";
+        case OP_EQ:         return "EQ";
+        case OP_EQW:        return "EQW";
+        case OP_MAND:       return "MAND";
+        case OP_JOIN:       return "JOIN";
+        case OP_BUFFER:     return "BUFFER";
+        case OP_CONST_ZERO: return "CONST_ZERO";
+        case OP_CONST_ONE:  return "CONST_ONE";
+        default:            return "INVALID";
+    }
+}
+
+// Maps a gate mnemonic (not NUL terminated) to its opcode without building a string.
+inline uint8_t opcodeFromMnemonic(const char* s, size_t len) {
+    switch (len) {
+        case 2:
+            if (std::memcmp(s, "EQ", 2) == 0) return OP_EQ;
+            break;
+        case 3:
+            if (std::memcmp(s, "XOR", 3) == 0) return OP_XOR;
+            if (std::memcmp(s, "AND", 3) == 0) return OP_AND;
+            if (std::memcmp(s, "INV", 3) == 0) return OP_INV;
+            if (std::memcmp(s, "EQW", 3) == 0) return OP_EQW;
+            break;
+        case 4:
+            if (std::memcmp(s, "MAND", 4) == 0) return OP_MAND;
+            if (std::memcmp(s, "JOIN", 4) == 0) return OP_JOIN;
+            break;
+        case 6:
+            if (std::memcmp(s, "BUFFER", 6) == 0) return OP_BUFFER;
+            break;
+        case 9:
+            if (std::memcmp(s, "CONST_ONE", 9) == 0) return OP_CONST_ONE;
+            break;
+        case 10:
+            if (std::memcmp(s, "CONST_ZERO", 10) == 0) return OP_CONST_ZERO;
+            break;
+    }
+    return OP_INVALID;
+}
+
+// One gate as seen by a reader; the wire pointers stay valid until the next gate is read.
+struct GateRecord {
+    uint8_t opcode;
+    int numInputs;
+    int numOutputs;
+    const int* inputs;
+    const int* outputs;
+};
+
+// Flat netlist: gate g reads wires[pinOffsets[2g] .. pinOffsets[2g+1]) and
+// drives wires[pinOffsets[2g+1] .. pinOffsets[2g+2]).
+struct FlatNetlist {
+    int numGates;
+    int numWires;
+    std::vector<int> inputWireCounts;
+    std::vector<int> outputWireCounts;
+    std::vector<uint8_t> opcodes;
+    std::vector<uint32_t> pinOffsets;
+    std::vector<int> wires;
+
+    FlatNetlist() : numGates(0), numWires(0), pinOffsets(1, 0) {}
+
+    int size() const { return static_cast<int>(opcodes.size()); }
+    int numInputs(int g) const { return pinOffsets[2 * g + 1] - pinOffsets[2 * g]; }
+    int numOutputs(int g) const { return pinOffsets[2 * g + 2] - pinOffsets[2 * g + 1]; }
+    const int* inputs(int g) const { return wires.data() + pinOffsets[2 * g]; }
+    const int* outputs(int g) const { return wires.data() + pinOffsets[2 * g + 1]; }
+
+    GateRecord gate(int g) const {
+        GateRecord record;
+        record.opcode = opcodes[g];
+        record.numInputs = numInputs(g);
+        record.numOutputs = numOutputs(g);
+        record.inputs = inputs(g);
+        record.outputs = outputs(g);
+        return record;
+    }
+
+    void reserve(size_t gates, size_t pins) {
+        opcodes.reserve(gates);
+        pinOffsets.reserve(2 * gates + 1);
+        wires.reserve(pins);
+    }
+
+    void clear() {
+        opcodes.clear();
+        pinOffsets.assign(1, 0);
+        wires.clear();
+    }
+
+    void addGate(uint8_t op, const int* in, int nIn, const int* out, int nOut) {
+        opcodes.push_back(op);
+        wires.insert(wires.end(), in, in + nIn);
+        pinOffsets.push_back(static_cast<uint32_t>(wires.size()));
+        wires.insert(wires.end(), out, out + nOut);
+        pinOffsets.push_back(static_cast<uint32_t>(wires.size()));
+    }
+
+    void addGate(const GateRecord& gate) {
+        addGate(gate.opcode, gate.inputs, gate.numInputs, gate.outputs, gate.numOutputs);
+    }
+};
+
+#endif
@@ -7,934 +7,733 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <queue>
+#include <tuple>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "circuit.h"
+#include "partition.h"
+#include "qbfEncoder.h"
+#include "stats.h"
+#include "synthesis.h"
+#include "threadPool.h"
+#include "transform.h"
+#include "windowCache.h"
 
 
 using namespace std;
 
-enum GateType { JOIN, BUFFER, XOR, CONST_ZERO, CONST_ONE };
-
-enum State { ZERO = 0, ONE = 1, Z = 2, X = 3 };
+// Content hash of a window as the encoder sees it: gates in local wire
+// numbering plus the encoder options. Renumbering wires elsewhere in the
+// circuit leaves it unchanged, so it names the window's artifacts across runs.
+uint64_t windowContentHash(const Circuit& window, const EncoderOptions& options) {
+    vector<int> inputs, outputs;
+    FlatNetlist netlist = windowNetlist(window, inputs, outputs);
+    int32_t header[4] = {1, options.inputEncoding, options.amoEncoding, netlist.size()};
+    uint64_t h = fnv1a(header, sizeof(header));
+    h = fnv1a(netlist.opcodes.data(), netlist.opcodes.size(), h);
+    h = fnv1a(netlist.pinOffsets.data(), netlist.pinOffsets.size() * sizeof(uint32_t), h);
+    h = fnv1a(netlist.wires.data(), netlist.wires.size() * sizeof(int), h);
+    h = fnv1a(inputs.data(), inputs.size() * sizeof(int), h);
+    return fnv1a(outputs.data(), outputs.size() * sizeof(int), h);
+}
 
-struct Gate {
-    GateType type;
-    int input1;
-    int input2;
-    int output;
-};
+string hexHash(uint64_t hash) {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
 
-bool operator==(const Gate& lhs, const Gate& rhs) {
-    return lhs.type == rhs.type &&
-           lhs.input1 == rhs.input1 &&
-           lhs.input2 == rhs.input2 &&
-           lhs.output == rhs.output;
+// Manifest of an incremental run, one line per window:
+//   <window> <content hash> <artifact>
+// Only the hashes matter when reading it back.
+unordered_set<uint64_t> readManifest(const string& filename) {
+    unordered_set<uint64_t> hashes;
+    ifstream in(filename);
+    int window;
+    string hash, artifact;
+    while (in >> window >> hash >> artifact) {
+        hashes.insert(stoull(hash, nullptr, 16));
+    }
+    return hashes;
 }
 
-// 2bits wire states.... since at least 3 legal states......
-struct WireVars {
-    int v1; 
-    int v2; 
-};
+bool fileExists(const string& filename) {
+    return access(filename.c_str(), F_OK) == 0;
+}
 
-// Circuit structure
-struct Circuit {
-    int numInputs;
-    int numOutputs;
-    vector<Gate> gates;
-    vector<int> inputWires;  
-    vector<int> outputWires;
-};
+// ---------------------------------------------------------------------------
+// Minimization driver: partition, synthesize each window's function with the
+// fewest gates a SAT solver can find, validate and splice the result back.
 
-// name map
-unordered_map<string, GateType> gateMap = {
-    {"JOIN", JOIN},
-    {"BUFFER", BUFFER},
-    {"XOR", XOR},
-    {"CONST_ZERO", CONST_ZERO},
-    {"CONST_ONE", CONST_ONE}
+struct MinimizeOptions {
+    string solver;
+    string workDir = "./qbf/";
+    double timeLimit = 0; // seconds, 0 = no limit
+    int maxPasses = 0;    // 0 = until no window improves
+    AmoEncoding amoEncoding = AMO_AUTO;
 };
 
-// helper func for pari hashing, will be used in gate selection
-struct pair_hash {
-    template <class T1, class T2>
-    std::size_t operator()(const std::pair<T1, T2>& p) const {
-        auto h1 = std::hash<T1>{}(p.first);
-        auto h2 = std::hash<T2>{}(p.second);
-        return h1 ^ h2;
-    }
-};
-
-Circuit readCircuit(const string& filename) {
-    ifstream infile(filename);
-    if (!infile) {
-        cerr << "Cannot open the file: " << filename << endl;
-        exit(1);
-    }
-
-    Circuit circuit;
-    string line;
-
-    getline(infile, line);
-    istringstream iss1(line);
-    int numGates, numWires;
-    iss1 >> numGates >> numWires;
-
-    getline(infile, line);
-    istringstream iss2(line);
-    int niv;
-    vector<int> numInputBitsPerValue;
-    int totalInputWires = 0;
-    iss2 >> niv;
-    for (int i = 0; i < niv; ++i) {
-        int ni;
-        iss2 >> ni;
-        numInputBitsPerValue.push_back(ni);
-        totalInputWires += ni;
-    }
-
-    getline(infile, line);
-    istringstream iss3(line);
-    int nov;
-    vector<int> numOutputBitsPerValue;
-    int totalOutputWires = 0;
-    iss3 >> nov;
-    for (int i = 0; i < nov; ++i) {
-        int no;
-        iss3 >> no;
-        numOutputBitsPerValue.push_back(no);
-        totalOutputWires += no;
-    }
-
-    int wireIndex = 0;
-
-    circuit.numInputs = totalInputWires;
-    for (int i = 0; i < totalInputWires; ++i) {
-        circuit.inputWires.push_back(wireIndex++);
-    }
-
-    while (getline(infile, line)) {
-        if (line.empty()) continue;
-        istringstream gateStream(line);
-        vector<string> tokens;
-        string token;
-        while (gateStream >> token) {
-            tokens.push_back(token);
-        }
-        if (tokens.empty()) continue;
-
-        int numInputs = stoi(tokens[0]);
-        int numOutputs = stoi(tokens[1]);
-
-        if (tokens.size() < 2 + numInputs + numOutputs + 1) {
-            cerr << "Invalid gate line: " << line << endl;
-            continue;
-        }
-
-        vector<int> inputWires;
-        for (int j = 0; j < numInputs; ++j) {
-            inputWires.push_back(stoi(tokens[2 + j]));
-        }
-
-        vector<int> outputWires;
-        for (int j = 0; j < numOutputs; ++j) {
-            int outWireID = stoi(tokens[2 + numInputs + j]);
-            outputWires.push_back(outWireID);
-        }
-
-        string gateName = tokens.back();
-        if (gateMap.find(gateName) == gateMap.end()) {
-            cerr << "Unknown gate type: " << gateName << endl;
-            continue;
-        }
-        GateType gateType = gateMap[gateName];
-
-        for (int j = 0; j < numOutputs; ++j) {
-            Gate gate;
-            gate.type = gateType;
-            gate.output = outputWires[j];
-            // how to handle input wires for buffer??????????????????, currently set to -1?????????????
-            gate.input1 = inputWires.size() > 0 ? inputWires[0] : -1;
-            gate.input2 = inputWires.size() > 1 ? inputWires[1] : -1;
-            circuit.gates.push_back(gate);
-        }
-    }
-
-    circuit.numOutputs = totalOutputWires;
-    for (int i = numWires - totalOutputWires; i < numWires; ++i) {
-        circuit.outputWires.push_back(i);
-    }
-
-    infile.close();
-    cout << "Input wires: ";
-    for (int wire : circuit.inputWires) {
-        cout << wire << " ";
-    }
-    cout << endl;
-    return circuit;
+// Searches downwards from currentGates - 1 until the solver says UNSAT, so a
+// completed search proves the last circuit found minimal. Every model is
+// checked against the truth table before it is trusted.
+bool synthesizeSmaller(const CanonicalWindow& canon, int currentGates, const MinimizeOptions& options,
+                       chrono::steady_clock::time_point deadline, CachedCircuit& best) {
+    int n = canon.numInputs;
+    int m = canon.numOutputs;
+    int rows = 1;
+    for (int j = 0; j < n; ++j) {
+        rows *= 3;
+    }
+    vector<uint8_t> table(static_cast<size_t>(rows) * m);
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = canon.table[i / 4] >> (2 * (i % 4)) & 3;
+    }
+    vector<int> inputs;
+    for (int j = 0; j < n; ++j) {
+        inputs.push_back(j);
+    }
+
+    bool found = false;
+    bool proven = false;
+    for (int k = currentGates - 1; k >= 1; --k) {
+        if (options.timeLimit > 0 && chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        SynthesisLayout layout = synthesisLayout(n, m, k, options.amoEncoding);
+        string cnfFile = options.workDir + hexHash(canon.hash) + "_" + to_string(k) + ".cnf";
+        if (!writeSynthesisCNF(table, layout, options.amoEncoding, cnfFile)) {
+            break;
+        }
+        vector<char> model;
+        SolverResult result = runSatSolver(options.solver, cnfFile, layout.numVars, model);
+        remove(cnfFile.c_str());
+        runStats().count("minimize.solver_calls");
+        if (result == SOLVER_UNSAT) {
+            proven = true;
+            break;
+        }
+        if (result != SOLVER_SAT) {
+            break;
+        }
+        CachedCircuit candidate;
+        decodeSynthesis(model, layout, candidate.netlist, candidate.outputs);
+        vector<uint8_t> check;
+        if (!windowTruthTable(candidate.netlist, inputs, candidate.outputs, check) || check != table) {
+            cerr << "Solver model for function " << hexHash(canon.hash) << " with " << k
+                 << " gates does not match its truth table, ignoring it" << endl;
+            break;
+        }
+        best = candidate;
+        found = true;
+        k = candidate.netlist.size(); // dead gates were pruned, continue below that
+        proven = k == 1;
+    }
+    best.solved = proven;
+    return found;
 }
 
-
-vector<int> topologicalSort(const Circuit& circuit) {
-    // Build adjacency list and compute in-degrees
-    unordered_map<int, vector<int>> adjList;
-    unordered_map<int, int> inDegree;
-    unordered_set<int> nodeSet;
-    for (const auto& gate : circuit.gates) {
-        nodeSet.insert(gate.output);
-        if (gate.input1 >= 0) {
-            adjList[gate.input1].push_back(gate.output);
-            inDegree[gate.output]++;
-            nodeSet.insert(gate.input1);
-        }
-        if (gate.input2 >= 0) {
-            adjList[gate.input2].push_back(gate.output);
-            inDegree[gate.output]++;
-            nodeSet.insert(gate.input2);
-        }
-        if (inDegree.find(gate.output) == inDegree.end()) {
-            inDegree[gate.output] = 0; 
-        }
-    }
-    queue<int> zeroInDegree;
-    for (int node : nodeSet) {
-        if (inDegree[node] == 0) {
-            zeroInDegree.push(node);
-        }
-    }
-    vector<int> topoOrder;
-    while (!zeroInDegree.empty()) {
-        int node = zeroInDegree.front();
-        zeroInDegree.pop();
-        topoOrder.push_back(node);
-
-        for (int neighbor : adjList[node]) {
-            inDegree[neighbor]--;
-            if (inDegree[neighbor] == 0) {
-                zeroInDegree.push(neighbor);
+// For each output, the set of inputs it structurally depends on.
+vector<uint64_t> dependencyMasks(const Circuit& window) {
+    unordered_map<int, uint64_t> mask;
+    for (size_t j = 0; j < window.inputWires.size(); ++j) {
+        mask[window.inputWires[j]] = 1ULL << j;
+    }
+    for (int g = 0; g < window.size(); ++g) {
+        Gate gate = window.gate(g);
+        uint64_t m = 0;
+        for (int wire : {gate.input1, gate.input2}) {
+            if (wire >= 0) {
+                m |= mask[wire];
             }
         }
+        mask[gate.output] = m;
     }
-    unordered_map<int, int> wireToGateIndex;
-    for (size_t i = 0; i < circuit.gates.size(); ++i) {
-        wireToGateIndex[circuit.gates[i].output] = i;
+    vector<uint64_t> masks;
+    for (int wire : window.outputWires) {
+        masks.push_back(mask[wire]);
     }
-    vector<int> sortedGateIndices;
-    for (int wireID : topoOrder) {
-        if (wireToGateIndex.find(wireID) != wireToGateIndex.end()) {
-            sortedGateIndices.push_back(wireToGateIndex[wireID]);
-        }
-    }
-
-    return sortedGateIndices;
+    return masks;
 }
 
-
-// TODO 10.15: WIERD RESULT WHEN HANDLING THE LAST SUBCIRCUIT, NEED TO FIX
-
-vector<Circuit> partitionCircuit(const Circuit& circuit, int windowSize) {
-    vector<Circuit> subcircuits;
-
-    unordered_map<int, vector<int>> wireToConsumerGates;
-    for (size_t idx = 0; idx < circuit.gates.size(); ++idx) {
-        const Gate& gate = circuit.gates[idx];
-        if (gate.input1 >= 0) {
-            wireToConsumerGates[gate.input1].push_back(idx);
+// Instantiates a cached circuit for a window in global wire IDs, reusing the
+// IDs of the window's internal wires. Fails unless the result has fewer gates,
+// computes the same truth table and depends on no input-to-output path the
+// window did not already have; the last check keeps several windows spliced
+// in one pass from closing a cycle through each other.
+bool instantiateWindow(const Circuit& window, const CanonicalWindow& canon, const CachedCircuit& cached,
+                       Circuit& replacement) {
+    const FlatNetlist& netlist = cached.netlist;
+    int n = canon.numInputs;
+    vector<int> rename(netlist.numWires, -1);
+    for (int j = 0; j < n; ++j) {
+        rename[j] = window.inputWires[canon.inputOrder[j]];
+    }
+    vector<int> copies; // canonical outputs that need a JOIN(w, w) copy
+    for (int k = 0; k < canon.numOutputs; ++k) {
+        int wire = cached.outputs[k];
+        if (wire >= n && rename[wire] < 0) {
+            rename[wire] = window.outputWires[canon.outputOrder[k]];
+        } else {
+            copies.push_back(k);
+        }
+    }
+    vector<int> freed;
+    unordered_set<int> outputSet(window.outputWires.begin(), window.outputWires.end());
+    for (int g = 0; g < window.size(); ++g) {
+        Gate gate = window.gate(g);
+        if (!outputSet.count(gate.output)) {
+            freed.push_back(gate.output);
+        }
+    }
+    if (netlist.size() + static_cast<int>(copies.size()) >= window.size()) {
+        return false;
+    }
+
+    replacement = window;
+    replacement.netlist.clear();
+    for (int g = 0; g < netlist.size(); ++g) {
+        int out = netlist.outputs(g)[0];
+        if (rename[out] < 0) {
+            if (freed.empty()) {
+                return false;
+            }
+            rename[out] = freed.back();
+            freed.pop_back();
         }
-        if (gate.input2 >= 0) {
-            wireToConsumerGates[gate.input2].push_back(idx);
+        int in[2];
+        for (int j = 0; j < netlist.numInputs(g); ++j) {
+            in[j] = rename[netlist.inputs(g)[j]];
         }
+        replacement.netlist.addGate(netlist.opcodes[g], in, netlist.numInputs(g), &rename[out], 1);
+    }
+    for (int k : copies) {
+        int in[2] = {rename[cached.outputs[k]], rename[cached.outputs[k]]};
+        replacement.netlist.addGate(OP_JOIN, in, 2, &window.outputWires[canon.outputOrder[k]], 1);
     }
 
-    vector<int> currentGateIndices;      
-    unordered_set<int> subcircuitWires;    
-    unordered_set<int> subcircuitInputWires; 
-    unordered_set<int> subcircuitOutputWires; 
-
-    vector<int> sortedGateIndices = topologicalSort(circuit);
-
-    for (int gateIndex : sortedGateIndices) {
-        const Gate& gate = circuit.gates[gateIndex];
-
-        currentGateIndices.push_back(gateIndex);
-        subcircuitWires.insert(gate.output);
-
-        if (gate.input1 >= 0 && subcircuitWires.count(gate.input1) == 0) {
-            subcircuitInputWires.insert(gate.input1);
-        }
-        if (gate.input2 >= 0 && subcircuitWires.count(gate.input2) == 0) {
-            subcircuitInputWires.insert(gate.input2);
+    vector<uint64_t> before = dependencyMasks(window);
+    vector<uint64_t> after = dependencyMasks(replacement);
+    for (size_t k = 0; k < before.size(); ++k) {
+        if (after[k] & ~before[k]) {
+            return false;
         }
+    }
+    vector<int> inputs, outputs;
+    vector<uint8_t> original, result;
+    FlatNetlist originalNetlist = windowNetlist(window, inputs, outputs);
+    windowTruthTable(originalNetlist, inputs, outputs, original);
+    FlatNetlist replacementNetlist = windowNetlist(replacement, inputs, outputs);
+    return windowTruthTable(replacementNetlist, inputs, outputs, result) && result == original;
+}
 
-        if (currentGateIndices.size() == windowSize) {
-
-            for (int wire : subcircuitWires) {
-                bool isOutputWire = false;
-
-                for (int consumerGateIndex : wireToConsumerGates[wire]) {
-                    if (std::find(currentGateIndices.begin(), currentGateIndices.end(), consumerGateIndex) == currentGateIndices.end()) {
-                        isOutputWire = true;
-                        break;
+// Runs passes until no window improves, maxPasses or the time limit. Returns
+// false if the circuit graph cannot be built or splicing closed a cycle.
+bool minimizeCircuit(Circuit& circuit, int maxGates, int maxInputs, const MinimizeOptions& options,
+                     WindowCache* cache, unsigned numThreads) {
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                chrono::duration<double>(options.timeLimit));
+    for (int pass = 1; options.maxPasses == 0 || pass <= options.maxPasses; ++pass) {
+        auto passStart = chrono::steady_clock::now();
+        CircuitGraph graph;
+        if (!buildCircuitGraph(circuit, graph)) {
+            return false;
+        }
+        vector<WindowStats> stats;
+        vector<Circuit> windows = partitionByCones(circuit, graph, maxGates, maxInputs, stats);
+
+        // One synthesis per distinct function
+        vector<CanonicalWindow> canon(windows.size());
+        vector<char> usable(windows.size(), 0);
+        parallelFor(windows.size(), numThreads, [&](int i) {
+            if (windows[i].size() < 2) {
+                return;
+            }
+            vector<int> inputs, outputs;
+            FlatNetlist netlist = windowNetlist(windows[i], inputs, outputs);
+            usable[i] = canonicalizeWindow(netlist, inputs, outputs, canon[i]);
+        });
+        vector<int> functionOf(windows.size(), -1);
+        vector<int> representative;
+        vector<int> smallest; // smallest window with each function
+        vector<int> currentGates;
+        unordered_map<uint64_t, vector<int>> byHash;
+        for (size_t i = 0; i < windows.size(); ++i) {
+            if (!usable[i]) {
+                continue;
+            }
+            for (int f : byHash[canon[i].hash]) {
+                if (canon[representative[f]].table == canon[i].table &&
+                    canon[representative[f]].numInputs == canon[i].numInputs) {
+                    functionOf[i] = f;
+                    if (static_cast<int>(windows[i].size()) < currentGates[f]) {
+                        currentGates[f] = windows[i].size();
+                        smallest[f] = i;
                     }
-                }
-
-                if (isOutputWire) {
-                    subcircuitOutputWires.insert(wire);
+                    break;
                 }
             }
-
-            Circuit subcircuit;
-            subcircuit.numInputs = subcircuitInputWires.size();
-            subcircuit.numOutputs = subcircuitOutputWires.size();
-
-            for (int idx : currentGateIndices) {
-                subcircuit.gates.push_back(circuit.gates[idx]);
+            if (functionOf[i] < 0) {
+                functionOf[i] = representative.size();
+                byHash[canon[i].hash].push_back(representative.size());
+                representative.push_back(i);
+                smallest.push_back(i);
+                currentGates.push_back(windows[i].size());
             }
-
-            subcircuit.inputWires.assign(subcircuitInputWires.begin(), subcircuitInputWires.end());
-            subcircuit.outputWires.assign(subcircuitOutputWires.begin(), subcircuitOutputWires.end());
-
-            subcircuits.push_back(subcircuit);
-
-            currentGateIndices.clear();
-            subcircuitWires.clear();
-            subcircuitInputWires.clear();
-            subcircuitOutputWires.clear();
         }
-    }
-
-    // Finalize the last subcircuit if it's not empty
-    if (!currentGateIndices.empty()) {
-        // Determine output wires
-        for (int wire : subcircuitWires) {
-            bool isOutputWire = false;
 
-            for (int consumerGateIndex : wireToConsumerGates[wire]) {
-                if (std::find(currentGateIndices.begin(), currentGateIndices.end(), consumerGateIndex) == currentGateIndices.end()) {
-                    isOutputWire = true;
-                    break;
+        vector<CachedCircuit> solutions(representative.size());
+        vector<char> solved(representative.size(), 0);
+        vector<char> fromCache(representative.size(), 0);
+        vector<char> learned(representative.size(), 0);
+        for (size_t f = 0; f < representative.size(); ++f) {
+            CachedCircuit cached;
+            if (cache && cache->lookup(canon[representative[f]], cached) &&
+                (cached.solved || cached.netlist.size() < currentGates[f])) {
+                solutions[f] = cached;
+                solved[f] = fromCache[f] = 1;
+                currentGates[f] = min(currentGates[f], cached.netlist.size());
+            }
+        }
+        parallelFor(representative.size(), numThreads, [&](int f) {
+            if (fromCache[f] && solutions[f].solved) {
+                return;
+            }
+            CachedCircuit found;
+            if (synthesizeSmaller(canon[representative[f]], currentGates[f], options, deadline, found)) {
+                solutions[f] = found;
+                solved[f] = learned[f] = 1;
+            } else if (found.solved) {
+                // nothing smaller exists: record the best implementation at hand
+                if (!fromCache[f]) {
+                    int i = smallest[f];
+                    vector<int> inputs, outputs;
+                    FlatNetlist netlist = windowNetlist(windows[i], inputs, outputs);
+                    solutions[f] = makeCachedCircuit(netlist, inputs, outputs, canon[i], true);
+                    solved[f] = 1;
                 }
+                solutions[f].solved = true;
+                learned[f] = 1;
             }
-
-            if (isOutputWire) {
-                subcircuitOutputWires.insert(wire);
+        });
+        if (cache) {
+            for (size_t f = 0; f < representative.size(); ++f) {
+                if (learned[f]) {
+                    cache->insert(canon[representative[f]], solutions[f]);
+                }
             }
         }
 
-        Circuit subcircuit;
-        subcircuit.numInputs = subcircuitInputWires.size();
-        subcircuit.numOutputs = subcircuitOutputWires.size();
-
-        for (int idx : currentGateIndices) {
-            subcircuit.gates.push_back(circuit.gates[idx]);
+        // Splice: drop every replaced window's gates, append the new ones
+        int before = circuit.size();
+        vector<char> removed(circuit.size(), 0);
+        vector<Circuit> added;
+        int replaced = 0;
+        for (size_t i = 0; i < windows.size(); ++i) {
+            int f = functionOf[i];
+            Circuit replacement;
+            if (f < 0 || !solved[f] || !instantiateWindow(windows[i], canon[i], solutions[f], replacement)) {
+                continue;
+            }
+            for (int g = 0; g < windows[i].size(); ++g) {
+                removed[graph.driver[windows[i].gate(g).output]] = 1;
+            }
+            added.push_back(std::move(replacement));
+            replaced++;
+        }
+        FlatNetlist next = circuit.netlist;
+        next.clear();
+        for (int g = 0; g < circuit.size(); ++g) {
+            if (!removed[g]) {
+                next.addGate(circuit.netlist.gate(g));
+            }
         }
-
-        subcircuit.inputWires.assign(subcircuitInputWires.begin(), subcircuitInputWires.end());
-        subcircuit.outputWires.assign(subcircuitOutputWires.begin(), subcircuitOutputWires.end());
-
-        subcircuits.push_back(subcircuit);
-    }
-
-    return subcircuits;
-}
-
-
-int getNextVarID() {
-    static int varID = 0;
-    return ++varID;
-}
-
-
-void addExactlyOneConstraint(const vector<int>& vars, vector<string>& clauses) {
-    // At least one variable is true
-    string atLeastOneClause;
-    for (int var : vars) {
-        atLeastOneClause += to_string(var) + " ";
-    }
-    atLeastOneClause += "0";
-    clauses.push_back(atLeastOneClause);
-
-    // At most one variable is true (pairwise mutual exclusion)
-    for (size_t i = 0; i < vars.size(); ++i) {
-        for (size_t j = i + 1; j < vars.size(); ++j) {
-            clauses.push_back(to_string(-vars[i]) + " " + to_string(-vars[j]) + " 0");
+        for (const Circuit& replacement : added) {
+            for (int g = 0; g < replacement.size(); ++g) {
+                next.addGate(replacement.netlist.gate(g));
+            }
         }
-    }
-}
-
-void addConstGateCompatibilityConstraints(
-    int funcVar,
-    GateType funcType,
-    int gateOutputVar_v1, int gateOutputVar_v2,
-    vector<string>& clauses
-) {
-    if (funcType == CONST_ZERO) {
-        // Clauses to enforce:
-        // -funcVar ∨ -gateOutputVar_v1
-        // -funcVar ∨ -gateOutputVar_v2
-
-        clauses.push_back(to_string(-funcVar) + " " + to_string(-gateOutputVar_v1) + " 0");
-        clauses.push_back(to_string(-funcVar) + " " + to_string(-gateOutputVar_v2) + " 0");
-
-    } else if (funcType == CONST_ONE) {
-        // Clauses to enforce:
-        // -funcVar ∨ -gateOutputVar_v1
-        // -funcVar ∨ gateOutputVar_v2
-
-        clauses.push_back(to_string(-funcVar) + " " + to_string(-gateOutputVar_v1) + " 0");
-        clauses.push_back(to_string(-funcVar) + " " + to_string(gateOutputVar_v2) + " 0");
-
-    } else {
-        cerr << "Invalid gate type in addConstGateCompatibilityConstraints" << endl;
-    }
-}
-
-// This part seems incorrect??????????????????. FIXED 10.16, much better now :)
+        circuit.netlist = std::move(next);
+        CircuitGraph order;
+        if (!buildCircuitGraph(circuit, order)) {
+            return false;
+        }
+        if (static_cast<int>(order.topoOrder.size()) != circuit.size()) {
+            cerr << "Splicing produced a cycle" << endl;
+            return false;
+        }
+        next = circuit.netlist;
+        next.clear();
+        for (int g : order.topoOrder) {
+            next.addGate(circuit.netlist.gate(g));
+        }
+        next.numGates = next.size();
+        circuit.netlist = std::move(next);
 
-void addBUFFERCompatibilityConstraints(
-    int funcVar, 
-    int selVar1, int selVar2,  
-    int controlVar_v1, int controlVar_v2, 
-    int dataVar_v1, int dataVar_v2, 
-    int gateOutputVar_v1, int gateOutputVar_v2, 
-    vector<string>& clauses
-) {
-    // Possible states for control and data
-    vector<tuple<int, int>> possibleStates = {
-        {1, 0}, // Z
-        {0, 0}, // 0
-        {0, 1}  // 1
-    };
-    
-    for (const auto& controlState : possibleStates) {
-        int c_v1 = get<0>(controlState);
-        int c_v2 = get<1>(controlState);
-        
-        for (const auto& dataState : possibleStates) {
-            int d_v1 = get<0>(dataState);
-            int d_v2 = get<1>(dataState);
-            
-            // Determine output based on control signal
-            int out_v1, out_v2;
-            if ( (c_v1 == 0 && c_v2 == 1) ) { // Control is 1
-                out_v1 = d_v1;
-                out_v2 = d_v2;
-            } else {
-                // Output is Z
-                out_v1 = 1;
-                out_v2 = 0;
-            }
-            
-            // Create clauses enforcing the output state
-            // For gateOutputVar_v1
-            string clause_v1 = "";
-            clause_v1 += to_string(-funcVar) + " ";
-            clause_v1 += to_string(-selVar1) + " ";
-            clause_v1 += to_string(-selVar2) + " ";
-            clause_v1 += (c_v1 == 1 ? to_string(controlVar_v1) : to_string(-controlVar_v1)) + " ";
-            clause_v1 += (c_v2 == 1 ? to_string(controlVar_v2) : to_string(-controlVar_v2)) + " ";
-            clause_v1 += (d_v1 == 1 ? to_string(dataVar_v1) : to_string(-dataVar_v1)) + " ";
-            clause_v1 += (d_v2 == 1 ? to_string(dataVar_v2) : to_string(-dataVar_v2)) + " ";
-            clause_v1 += (out_v1 == 1 ? to_string(gateOutputVar_v1) : to_string(-gateOutputVar_v1)) + " 0";
-            clauses.push_back(clause_v1);
-            
-            // For gateOutputVar_v2
-            string clause_v2 = "";
-            clause_v2 += to_string(-funcVar) + " ";
-            clause_v2 += to_string(-selVar1) + " ";
-            clause_v2 += to_string(-selVar2) + " ";
-            clause_v2 += (c_v1 == 1 ? to_string(controlVar_v1) : to_string(-controlVar_v1)) + " ";
-            clause_v2 += (c_v2 == 1 ? to_string(controlVar_v2) : to_string(-controlVar_v2)) + " ";
-            clause_v2 += (d_v1 == 1 ? to_string(dataVar_v1) : to_string(-dataVar_v1)) + " ";
-            clause_v2 += (d_v2 == 1 ? to_string(dataVar_v2) : to_string(-dataVar_v2)) + " ";
-            clause_v2 += (out_v2 == 1 ? to_string(gateOutputVar_v2) : to_string(-gateOutputVar_v2)) + " 0";
-            clauses.push_back(clause_v2);
+        int after = circuit.size();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - passStart).count();
+        cout << "Pass " << pass << ": " << windows.size() << " windows, " << representative.size()
+             << " distinct functions, " << replaced << " windows replaced, " << before << " -> " << after
+             << " gates (-" << (before > 0 ? 100.0 * (before - after) / before : 0) << "%), " << seconds << " s"
+             << endl;
+        runStats().count("minimize.passes");
+        runStats().count("minimize.windows_replaced", replaced);
+        if (after >= before) {
+            break;
+        }
+        if (options.timeLimit > 0 && chrono::steady_clock::now() >= deadline) {
+            cout << "Time limit reached" << endl;
+            break;
         }
     }
+    return true;
 }
 
-void addJOINCompatibilityConstraints(
-    int funcVar, 
-    int selVar1, int selVar2, 
-    int inputVar1_v1, int inputVar1_v2, 
-    int inputVar2_v1, int inputVar2_v2, 
-    int gateOutputVar_v1, int gateOutputVar_v2, 
-    vector<string>& clauses
-) {
-    vector<tuple<int, int>> inputStates = {
-        {1, 0}, // Z
-        {0, 0}, // 0
-        {0, 1}  // 1
-    };
-
-    // For each combination of input states
-    for (const auto& inputState1 : inputStates) {
-        int in1_v1 = get<0>(inputState1);
-        int in1_v2 = get<1>(inputState1);
-
-        for (const auto& inputState2 : inputStates) {
-            int in2_v1 = get<0>(inputState2);
-            int in2_v2 = get<1>(inputState2);
-            int out_v1, out_v2;
-            if ( (in1_v1 == 1 && in1_v2 == 1) || (in2_v1 == 1 && in2_v2 == 1) ) {
-                continue; 
+int main(int argc, char* argv[]) {
+    unsigned numThreads = 0; // 0 = hardware concurrency
+    EncoderOptions options;
+    bool sliceWindows = false;
+    bool verboseStats = false;
+    string cacheFile;
+    bool incremental = false;
+    bool simplify = false;
+    string minimizedFile;
+    MinimizeOptions minimizeOptions;
+    int maxGates = 7;
+    int maxInputs = 6;
+    string statsTarget;
+    vector<string> files;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            int count;
+            if (!parseCount(argv[++i], count)) {
+                cerr << "Invalid thread count: " << argv[i] << endl;
+                return 1;
             }
-
-            // Based on the truth table
-            if (in1_v1 == 1 && in1_v2 == 0) {
-                if (in2_v1 == 1 && in2_v2 == 0) {
-                    out_v1 = 1; // Z
-                    out_v2 = 0;
-                } else if ( (in2_v1 == 0 && in2_v2 == 0) || (in2_v1 == 0 && in2_v2 == 1) ) {
-                    out_v1 = in2_v1;
-                    out_v2 = in2_v2;
-                }
-            } else if (in1_v1 == 0 && in1_v2 == 0) {
-                if (in2_v1 == 1 && in2_v2 == 0) {
-                    out_v1 = 0;
-                    out_v2 = 0;
-                } else if (in2_v1 == 0 && in2_v2 == 0) {
-                    out_v1 = 0;
-                    out_v2 = 0;
-                } else if (in2_v1 == 0 && in2_v2 == 1) {
-                    out_v1 = 0;
-                    out_v2 = 0;
-                }
-            } else if (in1_v1 == 0 && in1_v2 == 1) {
-                if (in2_v1 == 1 && in2_v2 == 0) {
-                    out_v1 = 0;
-                    out_v2 = 1;
-                } else if (in2_v1 == 0 && in2_v2 == 0) {
-                    out_v1 = 0;
-                    out_v2 = 1;
-                } else if (in2_v1 == 0 && in2_v2 == 1) {
-                    out_v1 = 0;
-                    out_v2 = 1;
-                }
+            numThreads = count;
+        } else if (arg == "--partition" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode == "cones") {
+                sliceWindows = false;
+            } else if (mode == "slices") {
+                sliceWindows = true;
             } else {
-                continue;
+                cerr << "Unknown partitioner: " << mode << endl;
+                return 1;
             }
-
-            // Create clauses enforcing the output state when funcVar and selVars are true
-            // For gateOutputVar_v1
-            string clause_v1 = "";
-            clause_v1 += to_string(-funcVar) + " ";
-            clause_v1 += to_string(-selVar1) + " ";
-            clause_v1 += to_string(-selVar2) + " ";
-            clause_v1 += (in1_v1 == 1 ? to_string(inputVar1_v1) : to_string(-inputVar1_v1)) + " ";
-            clause_v1 += (in1_v2 == 1 ? to_string(inputVar1_v2) : to_string(-inputVar1_v2)) + " ";
-            clause_v1 += (in2_v1 == 1 ? to_string(inputVar2_v1) : to_string(-inputVar2_v1)) + " ";
-            clause_v1 += (in2_v2 == 1 ? to_string(inputVar2_v2) : to_string(-inputVar2_v2)) + " ";
-            clause_v1 += (out_v1 == 1 ? to_string(gateOutputVar_v1) : to_string(-gateOutputVar_v1)) + " 0";
-            clauses.push_back(clause_v1);
-
-            // For gateOutputVar_v2
-            string clause_v2 = "";
-            clause_v2 += to_string(-funcVar) + " ";
-            clause_v2 += to_string(-selVar1) + " ";
-            clause_v2 += to_string(-selVar2) + " ";
-            clause_v2 += (in1_v1 == 1 ? to_string(inputVar1_v1) : to_string(-inputVar1_v1)) + " ";
-            clause_v2 += (in1_v2 == 1 ? to_string(inputVar1_v2) : to_string(-inputVar1_v2)) + " ";
-            clause_v2 += (in2_v1 == 1 ? to_string(inputVar2_v1) : to_string(-inputVar2_v1)) + " ";
-            clause_v2 += (in2_v2 == 1 ? to_string(inputVar2_v2) : to_string(-inputVar2_v2)) + " ";
-            clause_v2 += (out_v2 == 1 ? to_string(gateOutputVar_v2) : to_string(-gateOutputVar_v2)) + " 0";
-            clauses.push_back(clause_v2);
-        }
-    }
-}
-
-
-void addXORCompatibilityConstraints(
-    int funcVar, 
-    int selVar1, int selVar2, 
-    int inputVar1_v1, int inputVar1_v2, 
-    int inputVar2_v1, int inputVar2_v2, 
-    int gateOutputVar_v1, int gateOutputVar_v2, 
-    vector<string>& clauses
-) {
-
-    vector<tuple<int, int>> inputStates = {
-        {1, 0}, // Z
-        {0, 0}, // 0
-        {0, 1}  // 1
-    };
-
-    // For each combination of input states
-    for (const auto& inputState1 : inputStates) {
-        int in1_v1 = get<0>(inputState1);
-        int in1_v2 = get<1>(inputState1);
-
-        for (const auto& inputState2 : inputStates) {
-            int in2_v1 = get<0>(inputState2);
-            int in2_v2 = get<1>(inputState2);
-
-            // Determine the output state based on the XOR truth table
-            int out_v1, out_v2;
-            // Handle illegal states
-            if ( (in1_v1 == 1 && in1_v2 == 1) || (in2_v1 == 1 && in2_v2 == 1) ) {
-                continue; // Skip illegal input combinations
+        } else if (arg == "--minimize" && i + 1 < argc) {
+            minimizedFile = argv[++i];
+        } else if (arg == "--solver" && i + 1 < argc) {
+            minimizeOptions.solver = argv[++i];
+        } else if (arg == "--time-limit" && i + 1 < argc) {
+            char* end;
+            minimizeOptions.timeLimit = strtod(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !std::isfinite(minimizeOptions.timeLimit) ||
+                minimizeOptions.timeLimit < 0) {
+                cerr << "Invalid value for --time-limit: " << argv[i] << endl;
+                return 1;
             }
-
-            // Based on the truth table
-            if (in1_v1 == 1 && in1_v2 == 0) {
-                if (in2_v1 == 1 && in2_v2 == 0) {
-                    out_v1 = 1; 
-                    out_v2 = 0;
-                } else if ( (in2_v1 == 0 && in2_v2 == 0) || (in2_v1 == 0 && in2_v2 == 1) ) {
-                    out_v1 = 1;
-                    out_v2 = 0; 
-                }
-            } else if ( (in1_v1 == 0 && in1_v2 == 0) || (in1_v1 == 0 && in1_v2 == 1) ) {
-                if (in2_v1 == 1 && in2_v2 == 0) {
-                    out_v1 = 1;
-                    out_v2 = 0; 
-                } else if (in2_v1 == 0 && in2_v2 == 0) {
-                    out_v1 = 0;
-                    out_v2 = 0; 
-                } else if (in2_v1 == 0 && in2_v2 == 1) {
-                    out_v1 = 0;
-                    out_v2 = 1;
-                }
+        } else if (arg == "--max-passes" && i + 1 < argc) {
+            if (!parseCount(argv[++i], minimizeOptions.maxPasses)) {
+                cerr << "Invalid value for --max-passes: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--incremental") {
+            incremental = true;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheFile = argv[++i];
+        } else if (arg == "--simplify") {
+            simplify = true;
+        } else if (arg == "--window-stats") {
+            verboseStats = true;
+        } else if (arg == "--stats") {
+            statsTarget = "json";
+        } else if (arg.compare(0, 8, "--stats=") == 0) {
+            statsTarget = arg.substr(8);
+        } else if (arg == "--max-gates" && i + 1 < argc) {
+            if (!parseCount(argv[++i], maxGates)) {
+                cerr << "Invalid value for --max-gates: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--max-inputs" && i + 1 < argc) {
+            if (!parseCount(argv[++i], maxInputs)) {
+                cerr << "Invalid value for --max-inputs: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--amo" && i + 1 < argc) {
+            if (!parseAmoEncoding(argv[++i], options.amoEncoding)) {
+                cerr << "Unknown at-most-one encoding: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--input-encoding" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode == "pairs") {
+                options.inputEncoding = PAIRWISE_INPUTS;
+            } else if (mode == "mux") {
+                options.inputEncoding = MUX_INPUTS;
             } else {
-                continue;
+                cerr << "Unknown input encoding: " << mode << endl;
+                return 1;
             }
-
-            // Create clauses enforcing the output state when funcVar and selVars are true
-            // For gateOutputVar_v1
-            string clause_v1 = "";
-            clause_v1 += to_string(-funcVar) + " ";
-            clause_v1 += to_string(-selVar1) + " ";
-            clause_v1 += to_string(-selVar2) + " ";
-            clause_v1 += (in1_v1 == 1 ? to_string(inputVar1_v1) : to_string(-inputVar1_v1)) + " ";
-            clause_v1 += (in1_v2 == 1 ? to_string(inputVar1_v2) : to_string(-inputVar1_v2)) + " ";
-            clause_v1 += (in2_v1 == 1 ? to_string(inputVar2_v1) : to_string(-inputVar2_v1)) + " ";
-            clause_v1 += (in2_v2 == 1 ? to_string(inputVar2_v2) : to_string(-inputVar2_v2)) + " ";
-            clause_v1 += (out_v1 == 1 ? to_string(gateOutputVar_v1) : to_string(-gateOutputVar_v1)) + " 0";
-            clauses.push_back(clause_v1);
-
-            // For gateOutputVar_v2
-            string clause_v2 = "";
-            clause_v2 += to_string(-funcVar) + " ";
-            clause_v2 += to_string(-selVar1) + " ";
-            clause_v2 += to_string(-selVar2) + " ";
-            clause_v2 += (in1_v1 == 1 ? to_string(inputVar1_v1) : to_string(-inputVar1_v1)) + " ";
-            clause_v2 += (in1_v2 == 1 ? to_string(inputVar1_v2) : to_string(-inputVar1_v2)) + " ";
-            clause_v2 += (in2_v1 == 1 ? to_string(inputVar2_v1) : to_string(-inputVar2_v1)) + " ";
-            clause_v2 += (in2_v2 == 1 ? to_string(inputVar2_v2) : to_string(-inputVar2_v2)) + " ";
-            clause_v2 += (out_v2 == 1 ? to_string(gateOutputVar_v2) : to_string(-gateOutputVar_v2)) + " 0";
-            clauses.push_back(clause_v2);
+        } else {
+            files.push_back(arg);
         }
     }
-}
-
-
-// MAIN FUNCTION for ENCODING PROCEDURE
-// -----------------------------------
-// TODO: TEST THIS FUNCTION 
-// -----------------------------------
-// TODO: COMMENTS NEEDED. DONE 10.15
-// -----------------------------------
-
-void encodeSubcircuitAsQBF(const Circuit& subcircuit, const string& filename) {
-    ofstream outfile(filename);
-    if (!outfile) {
-        cerr << "Cannot open the file: " << filename << endl;
-        exit(1);
-    }
-
-    int varCounter = 0; // Variable counter for assigning unique IDs
-
-    unordered_set<int> inputVars;        // Input variables (x_t)
-    unordered_set<int> gateValueVars;    // Gate value variables (g_t)
-    vector<int> selectionVars;           // Selection variables (s_{it})
-    vector<int> gateFunctionVars;        // Gate definition variables (f_{i,a1a2})
-    unordered_set<int> outputVars;       // Output variables (o_{tj})
-
-    unordered_map<int, WireVars> wireVarMap; // Maps wire IDs to WireVars
-    unordered_map<pair<int, int>, int, pair_hash> selectionVarMap; // Maps (gateIndex * maxNumInputPins + inputPin, t) to selection variable ID
-    unordered_map<pair<int, GateType>, int, pair_hash> gateFunctionVarMap; // Maps (gateIndex, GateType) to function variable ID
-
-    int n = subcircuit.numInputs;
-    cout << "Number of inputs: " << n << endl;
-    int numOutputs = subcircuit.numOutputs;
-    cout << "Number of outputs: " << numOutputs << endl;
-    int numGates = subcircuit.gates.size();
-    cout << "Number of gates: " << numGates << endl;
-    vector<GateType> possibleFunctions = {XOR, BUFFER, JOIN, CONST_ZERO, CONST_ONE};
-
-    // Function to get the number of inputs for each gate type
-    // TODO: For buffer, index the control wire.
-    auto getNumInputs = [](GateType type) -> int {
-        switch (type) {
-            case BUFFER:
-            case JOIN:
-            case XOR:
-                return 2;
-            case CONST_ZERO:
-            case CONST_ONE:
-                return 0;
-            default:
-                return 0;
-        }
-    };
-
-    // Collect wire IDs for primary inputs
-    vector<int> possibleInputs;
-    for (int i = 0; i < n; ++i) {
-        possibleInputs.push_back(i); // Assuming wire IDs for inputs are 0 to n-1
-        WireVars vars;
-        vars.v1 = ++varCounter;
-        inputVars.insert(vars.v1);
-        vars.v2 = ++varCounter;
-        inputVars.insert(vars.v2);
-        wireVarMap[i] = vars;
-    }
-
-    // gate outputs (gate value variables)
-    for (int i = 0; i < numGates; ++i) {
-        int gateOutputWireID = subcircuit.gates[i].output;
-        if (wireVarMap.find(gateOutputWireID) == wireVarMap.end()) {
-            WireVars vars;
-            vars.v1 = ++varCounter;
-            vars.v2 = ++varCounter;
-            gateValueVars.insert(vars.v1);
-            gateValueVars.insert(vars.v2);
-            wireVarMap[gateOutputWireID] = vars;
-        }
-        // Add gate output wire to possible inputs for subsequent gates
-        possibleInputs.push_back(gateOutputWireID);
+    if (files.size() != 1) {
+        std::cerr << "Usage: [-j threads] [--partition cones|slices] [--max-gates N] [--max-inputs N] [--simplify] [--window-stats] [--stats[=json|file]] [--cache file] [--incremental] [--minimize out --solver cmd [--time-limit s] [--max-passes N]] [--input-encoding pairs|mux] [--amo auto|pairwise|sequential|commander|product] <input_circuit_file>" << std::endl;
+        return 1;
     }
-
-    // selection variables (s_{it})
-    int maxNumInputPins = 2; // Maximum number of inputs any gate can have, 2 by default..... Need to change for buffer
-    for (int i = 0; i < numGates; ++i) {
-        int numPins = getNumInputs(subcircuit.gates[i].type);
-        if (numPins == 0) {
-            continue; 
-        }
-        for (int inputPin = 0; inputPin < numPins; ++inputPin) {
-            for (int t = 0; t < possibleInputs.size(); ++t) {
-                int varID = ++varCounter;
-                selectionVars.push_back(varID);
-                selectionVarMap[{i * maxNumInputPins + inputPin, t}] = varID;
-            }
-        }
+    if (maxGates < 1 || maxInputs < 2) {
+        cerr << "Window budget needs at least 1 gate and 2 inputs" << endl;
+        return 1;
     }
-
-    // Afunction variables (f_{i,a1a2})
-    for (int i = 0; i < numGates; ++i) {
-        for (const auto& funcType : possibleFunctions) {
-            int varID = ++varCounter;
-            gateFunctionVars.push_back(varID);
-            gateFunctionVarMap[{i, funcType}] = varID;
-        }
+    if (!minimizedFile.empty() && minimizeOptions.solver.empty()) {
+        cerr << "--minimize needs a SAT solver command, e.g. --solver \"kissat -q\"" << endl;
+        return 1;
     }
-
-    // output variables (o_{tj})
-    vector<int> outputWireIDs;
-    for (int i = numGates - numOutputs; i < numGates; ++i) {
-        int outputWireID = subcircuit.gates[i].output;
-        outputWireIDs.push_back(outputWireID);
-        // Outputs are already in wireVarMap
-        outputVars.insert(wireVarMap[outputWireID].v1);
-        outputVars.insert(wireVarMap[outputWireID].v2);
+    if (!statsTarget.empty()) {
+        runStats().enable();
     }
-
-    outfile << "p cnf " << varCounter << " CLAUSE_COUNT_PLACEHOLDER" << endl;
-
-    // Universal quantification for input variables (x_t)
-    // Currently, universal quantification contains all other variables
-
-    // -------------------------------------
-    // TODO: Need verification if universal quantification is correct, NO? 10.15
-    // -------------------------------------
-
-    outfile << "a ";
-    for (int var : inputVars) {
-        outfile << var << " ";
+    Circuit circuit;
+    {
+        ScopedPhase phase("read");
+        circuit = readCircuit(files[0]);
     }
-    outfile << "0" << endl;
-
-    // Existential quantification for other variables
-    outfile << "e ";
-    for (int var = 1; var <= varCounter; ++var) {
-        if (inputVars.find(var) == inputVars.end()) {
-            outfile << var << " ";
+    runStats().count("gates", circuit.size());
+    if (simplify) {
+        ScopedPhase phase("simplify");
+        // unread wires count as outputs here, as they do for the partitioner
+        if (!simplifyCircuit(circuit.netlist, circuit.netlist.numWires, circuit.numOutputs, true)) {
+            return 1;
         }
+        cout << "Simplified to " << circuit.size() << " gates" << endl;
     }
-    outfile << "0" << endl;
-
-    vector<string> clauses;
-
-    // 1. no wire in the illegal state
-    for (const auto& entry : wireVarMap) {
-        int v1 = entry.second.v1;
-        int v2 = entry.second.v2;
-        // Clause: -v1 ∨ -v2 (at least one of v1 or v2 is 0)
-        clauses.push_back(to_string(-v1) + " " + to_string(-v2) + " 0");
+    cout << "Input wires: ";
+    for (int wire : circuit.inputWires) {
+        cout << wire << " ";
     }
+    cout << endl;
 
-    // 2. exactly one selection variable is true
-    for (int i = 0; i < numGates; ++i) {
-        int numPins = getNumInputs(subcircuit.gates[i].type);
-        if (numPins == 0) {
-            continue; 
-        }
-        for (int inputPin = 0; inputPin < numPins; ++inputPin) {
-            vector<int> gateSelectionVars;
-            for (int t = 0; t < possibleInputs.size(); ++t) {
-                int selVar = selectionVarMap[{i * maxNumInputPins + inputPin, t}];
-                gateSelectionVars.push_back(selVar);
+    if (!minimizedFile.empty()) {
+        WindowCache cache;
+        if (!cacheFile.empty() && !cache.open(cacheFile)) {
+            return 1;
+        }
+        minimizeOptions.amoEncoding = options.amoEncoding;
+        {
+            ScopedPhase phase("minimize");
+            if (!minimizeCircuit(circuit, maxGates, maxInputs, minimizeOptions, cacheFile.empty() ? nullptr : &cache,
+                                 numThreads)) {
+                return 1;
             }
-            // Add constraints that exactly one selection variable is true
-            addExactlyOneConstraint(gateSelectionVars, clauses);
         }
+        runStats().count("minimized_gates", circuit.size());
+        bool ok = writeCircuit(minimizedFile, circuit) && cache.close();
+        cout << "Minimized circuit (" << circuit.size() << " gates) written to " << minimizedFile << endl;
+        return ok && runStats().write(statsTarget) ? 0 : 1;
     }
 
-    // 3. exactly one function is selected
-    for (int i = 0; i < numGates; ++i) {
-        vector<int> gateFuncVars;
-        for (const auto& funcType : possibleFunctions) {
-            int funcVar = gateFunctionVarMap[{i, funcType}];
-            gateFuncVars.push_back(funcVar);
+    CircuitGraph graph;
+    {
+        ScopedPhase phase("graph");
+        if (!buildCircuitGraph(circuit, graph)) {
+            return 1;
         }
-        // Add constraint that exactly one function variable is true
-        addExactlyOneConstraint(gateFuncVars, clauses);
     }
+    cout << "Circuit depth: " << graph.depth << endl;
 
-    // 4. gate outputs are consistent with selected inputs and functions
-    for (int i = 0; i < numGates; ++i) {
-        const Gate& gate = subcircuit.gates[i];
-        int gateOutputWireID = gate.output;
-        WireVars gateOutputVars = wireVarMap[gateOutputWireID];
-
-        int numPins = getNumInputs(gate.type);
-
-        if (numPins == 0) {
-            for (const auto& funcType : possibleFunctions) {
-                int funcVar = gateFunctionVarMap[{i, funcType}];
-
-                if (funcType == CONST_ZERO || funcType == CONST_ONE) {
-                    addConstGateCompatibilityConstraints(
-                        funcVar,
-                        funcType,
-                        gateOutputVars.v1,
-                        gateOutputVars.v2,
-                        clauses
-                    );
-                }
+    vector<WindowStats> windowStats;
+    vector<Circuit> subcircuits;
+    {
+        ScopedPhase phase("partition");
+        subcircuits = sliceWindows ? partitionCircuit(circuit, graph, maxGates, windowStats)
+                                   : partitionByCones(circuit, graph, maxGates, maxInputs, windowStats);
+    }
+    printWindowStats(windowStats, verboseStats, cout);
+    runStats().count("windows", subcircuits.size());
+
+    // Windows are independent: encode them on a work-stealing pool. Each one
+    // logs into its own buffer and the logs are printed in window order, so
+    // output stays the same for any thread count.
+    vector<string> logs(subcircuits.size());
+    vector<int> toEncode;
+    WindowCache cache;
+    if (cacheFile.empty()) {
+        for (size_t i = 0; i < subcircuits.size(); ++i) {
+            toEncode.push_back(i);
+        }
+    } else {
+        ScopedPhase phase("cache");
+        if (!cache.open(cacheFile)) {
+            return 1;
+        }
+        // Canonical keys in parallel, then lookups and in-run deduplication in
+        // window order so the result does not depend on the thread count
+        vector<CanonicalWindow> canon(subcircuits.size());
+        vector<char> canonical(subcircuits.size(), 0);
+        parallelFor(subcircuits.size(), numThreads, [&](int i) {
+            vector<int> inputs, outputs;
+            FlatNetlist netlist = windowNetlist(subcircuits[i], inputs, outputs);
+            canonical[i] = canonicalizeWindow(netlist, inputs, outputs, canon[i]);
+        });
+        long long hits = 0, misses = 0, duplicates = 0, uncached = 0;
+        unordered_map<uint64_t, vector<int>> firstSeen;
+        for (size_t i = 0; i < subcircuits.size(); ++i) {
+            ostringstream log;
+            CachedCircuit cached;
+            if (!canonical[i]) {
+                uncached++;
+                toEncode.push_back(i);
+                continue;
             }
-        } else if (numPins == 2) {
-            for (int t1 = 0; t1 < possibleInputs.size(); ++t1) {
-                int selVar1 = selectionVarMap[{i * maxNumInputPins, t1}];
-                WireVars inputVars1 = wireVarMap[possibleInputs[t1]];
-
-                for (int t2 = 0; t2 < possibleInputs.size(); ++t2) {
-                    int selVar2 = selectionVarMap[{i * maxNumInputPins + 1, t2}];
-                    WireVars inputVars2 = wireVarMap[possibleInputs[t2]];
-
-                    for (const auto& funcType : possibleFunctions) {
-                        int funcVar = gateFunctionVarMap[{i, funcType}];
-
-                        if (funcType == BUFFER) {
-                            addBUFFERCompatibilityConstraints(
-                                funcVar, selVar1, selVar2,
-                                inputVars1.v1, inputVars1.v2,
-                                inputVars2.v1, inputVars2.v2,
-                                gateOutputVars.v1, gateOutputVars.v2,
-                                clauses
-                            );
-                        } else if (funcType == XOR) {
-                            addXORCompatibilityConstraints(
-                                funcVar, selVar1, selVar2,
-                                inputVars1.v1, inputVars1.v2,
-                                inputVars2.v1, inputVars2.v2,
-                                gateOutputVars.v1, gateOutputVars.v2,
-                                clauses
-                            );
-                        } else if (funcType == JOIN) {
-                            addJOINCompatibilityConstraints(
-                                funcVar, selVar1, selVar2,
-                                inputVars1.v1, inputVars1.v2,
-                                inputVars2.v1, inputVars2.v2,
-                                gateOutputVars.v1, gateOutputVars.v2,
-                                clauses
-                            );
-                        }
-                    }
-                }
+            if (cache.lookup(canon[i], cached) && cached.solved) {
+                hits++;
+                log << "Subcircuit " << i + 1 << ": cache hit, " << cached.netlist.size() << " gates instead of "
+                    << subcircuits[i].size() << endl;
+                logs[i] = log.str();
+                continue;
             }
-        } 
-    }
-
-    // 5. acyclicity
-    for (int i = 0; i < numGates; ++i) {
-        int numPins = getNumInputs(subcircuit.gates[i].type);
-        if (numPins == 0) {
-            continue; 
-        }
-        for (int inputPin = 0; inputPin < numPins; ++inputPin) {
-            for (int t = 0; t < possibleInputs.size(); ++t) {
-                int inputWireID = possibleInputs[t];
-                bool invalidInput = false;
-                for (int j = i; j < numGates; ++j) {
-                    if (subcircuit.gates[j].output == inputWireID) {
-                        invalidInput = true;
-                        break;
-                    }
-                }
-                if (invalidInput) {
-                    // Add clause to prevent selection of this input
-                    int selVar = selectionVarMap[{i * maxNumInputPins + inputPin, t}];
-                    clauses.push_back(to_string(-selVar) + " 0");
+            misses++;
+            int same = -1;
+            for (int j : firstSeen[canon[i].hash]) {
+                if (canon[j].numInputs == canon[i].numInputs && canon[j].numOutputs == canon[i].numOutputs &&
+                    canon[j].table == canon[i].table) {
+                    same = j;
+                    break;
                 }
             }
+            if (same >= 0) {
+                duplicates++;
+                log << "Subcircuit " << i + 1 << " has the same function as subcircuit " << same + 1 << endl;
+                logs[i] = log.str();
+                continue;
+            }
+            firstSeen[canon[i].hash].push_back(i);
+            toEncode.push_back(i);
+            if (!cache.lookup(canon[i], cached)) {
+                vector<int> inputs, outputs;
+                FlatNetlist netlist = windowNetlist(subcircuits[i], inputs, outputs);
+                cache.insert(canon[i], makeCachedCircuit(netlist, inputs, outputs, canon[i], false));
+            }
         }
-    }
-
-    // 6. symmetry breaking
-    // Manually check acyclicity of the circuit and add symmetry breaking constraints
-    for (int i = 1; i < numGates; ++i) {
-        for (const auto& funcTypePrev : possibleFunctions) {
-            for (const auto& funcTypeCurr : possibleFunctions) {
-                if (funcTypeCurr < funcTypePrev) {
-                    int funcVarPrev = gateFunctionVarMap[{i - 1, funcTypePrev}];
-                    int funcVarCurr = gateFunctionVarMap[{i, funcTypeCurr}];
-                    // Add constraint: -(funcVarPrev) ∨ -(funcVarCurr)
-                    clauses.push_back(to_string(-funcVarPrev) + " " + to_string(-funcVarCurr) + " 0");
-                }
+        cout << "Cache: " << hits << " hits, " << misses << " misses (" << duplicates
+             << " duplicates within this run), " << uncached << " windows too wide to cache" << endl;
+        runStats().count("cache.hits", hits);
+        runStats().count("cache.misses", misses);
+        runStats().count("cache.duplicates", duplicates);
+    }
+
+    // Incremental runs name artifacts by window content, so a window that is
+    // unchanged since the last run finds its formula already on disk
+    const string qbfDir = "./qbf/";
+    vector<string> artifacts(subcircuits.size());
+    vector<char> reused(subcircuits.size(), 0);
+    vector<uint64_t> hashes(subcircuits.size());
+    unordered_set<uint64_t> previous;
+    if (incremental) {
+        ScopedPhase phase("hash");
+        previous = readManifest(qbfDir + "manifest.txt");
+        parallelFor(subcircuits.size(), numThreads, [&](int i) {
+            hashes[i] = windowContentHash(subcircuits[i], options);
+        });
+        // identical windows in this run share one artifact, written once
+        unordered_set<uint64_t> claimed;
+        for (int i : toEncode) {
+            artifacts[i] = hexHash(hashes[i]) + ".qdimacs";
+            if (!claimed.insert(hashes[i]).second) {
+                reused[i] = 2;
+            } else if (previous.count(hashes[i]) && fileExists(qbfDir + artifacts[i])) {
+                reused[i] = 1;
             }
         }
+    } else {
+        for (size_t i = 0; i < subcircuits.size(); ++i) {
+            artifacts[i] = "subcircuit_" + to_string(i + 1) + ".qdimacs";
+        }
+    }
+
+    // a per-window record for --stats; timing is skipped when it is off
+    bool collect = runStats().enabled();
+    auto encodeWindow = [&](int i, const string& filename, ostringstream& log) {
+        auto start = collect ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+        QbfSize size = encodeSubcircuitAsQBF(subcircuits[i], filename, options, log);
+        if (collect) {
+            WindowRecord record;
+            record.window = i + 1;
+            record.gates = subcircuits[i].size();
+            record.inputs = subcircuits[i].numInputs;
+            record.outputs = subcircuits[i].numOutputs;
+            record.vars = size.vars;
+            record.clauses = size.clauses;
+            record.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            runStats().addWindow(record);
+            runStats().count("encoded_windows");
+            runStats().count("vars", size.vars);
+            runStats().count("clauses", size.clauses);
+        }
+    };
+    {
+        ScopedPhase phase("encode");
+        parallelFor(toEncode.size(), numThreads, [&](int k) {
+            int i = toEncode[k];
+            ostringstream log;
+            string qbfFilename = qbfDir + artifacts[i];
+            if (reused[i] == 2) {
+                log << "Subcircuit " << i + 1 << " is identical to an earlier window, sharing " << qbfFilename << endl;
+            } else if (reused[i]) {
+                log << "Subcircuit " << i + 1 << " is unchanged, keeping " << qbfFilename << endl;
+            } else if (incremental) {
+                // write under a temporary name so an interrupted run never leaves
+                // a partial artifact that a later run would take as current
+                encodeWindow(i, qbfFilename + ".tmp", log);
+                if (rename((qbfFilename + ".tmp").c_str(), qbfFilename.c_str()) != 0) {
+                    cerr << "Cannot rename to " << qbfFilename << endl;
+                    exit(1);
+                }
+                log << "Subcircuit " << i + 1 << " has been written to " << qbfFilename << endl;
+            } else {
+                encodeWindow(i, qbfFilename, log);
+                log << "Subcircuit " << i + 1 << " has been written to " << qbfFilename << endl;
+            }
+            logs[i] = log.str();
+        });
     }
-
-    // output
-    int totalClauses = clauses.size();
-    for (const string& clause : clauses) {
-        outfile << clause << endl;
-    }
-
-    outfile.seekp(0, ios::beg);
-    outfile << "p cnf " << varCounter << " " << totalClauses << endl;
-
-    outfile.close();
-}
-
-
-
-
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: <input_circuit_file>" << std::endl;
-        return 1;
+    for (const string& log : logs) {
+        cout << log;
     }
-    Circuit circuit = readCircuit(argv[1]);
 
-    int windowSize = 7; // Define the window size as needed
-    vector<Circuit> subcircuits = partitionCircuit(circuit, windowSize);
-
-    for (size_t i = 0; i < subcircuits.size(); ++i) {
-        string qbfFilename = "./qbf/subcircuit_" + to_string(i + 1) + ".qdimacs";
-        encodeSubcircuitAsQBF(subcircuits[i], qbfFilename);
-        cout << "Subcircuit " << i + 1 << " has been written to " << qbfFilename << endl;
+    if (incremental) {
+        int numEncoded = 0, numReused = 0, numShared = 0;
+        unordered_set<uint64_t> current;
+        vector<char> encoded(subcircuits.size(), 0);
+        for (int i : toEncode) {
+            (reused[i] == 2 ? numShared : reused[i] ? numReused : numEncoded)++;
+            encoded[i] = 1;
+        }
+        // windows answered by the cache have no artifact of their own
+        ofstream manifest(qbfDir + "manifest.txt");
+        for (size_t i = 0; i < subcircuits.size(); ++i) {
+            manifest << i + 1 << " " << hexHash(hashes[i]) << " " << (encoded[i] ? artifacts[i] : "-") << "\n";
+            current.insert(hashes[i]);
+        }
+        int stale = 0;
+        for (uint64_t hash : previous) {
+            stale += current.count(hash) == 0;
+        }
+        if (!manifest) {
+            cerr << "Error writing " << qbfDir << "manifest.txt" << endl;
+            return 1;
+        }
+        cout << "Incremental: " << numEncoded << " windows encoded, " << numReused << " unchanged since the last run, "
+             << numShared << " identical to another window, " << stale << " artifacts from the previous run no longer referenced" << endl;
+        runStats().count("incremental.reused", numReused);
+        runStats().count("incremental.shared", numShared);
     }
 
-    return 0;
+    return cache.close() && runStats().write(statsTarget) ? 0 : 1;
 }
@@ -0,0 +1,280 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "circuit.h"
+
+struct WindowStats {
+    int gates;
+    int inputs;
+    int outputs;
+    int internalEdges; // gate input pins driven inside the window
+};
+
+// Builds the subcircuit for the gates marked windowId in windowOf. Inputs are
+// wires read but not driven inside the window; outputs are wires driven inside
+// that are read outside it, are primary outputs or are read by nothing. Gates stay in topological
+// order, with gates that drive outputs placed last wherever dependencies
+// allow, since that is where encodeSubcircuitAsQBF looks for them. Runs in
+// time linear in the window's fan-in and fan-out.
+inline Circuit extractWindow(const Circuit& circuit, const CircuitGraph& graph, std::vector<int> gateIndices,
+                             const std::vector<int>& windowOf, int windowId, WindowStats& stats) {
+    std::sort(gateIndices.begin(), gateIndices.end());
+    int k = gateIndices.size();
+    auto local = [&](int wire) {
+        int g = wire >= 0 ? graph.driver[wire] : -1;
+        if (g < 0 || windowOf[g] != windowId) {
+            return -1;
+        }
+        return static_cast<int>(std::lower_bound(gateIndices.begin(), gateIndices.end(), g) - gateIndices.begin());
+    };
+
+    Circuit window;
+    std::vector<int> pending(k, 0);
+    std::vector<int> drivesOutput(k, 0);
+    for (int i = 0; i < k; ++i) {
+        Gate gate = circuit.gate(gateIndices[i]);
+        for (int wire : {gate.input1, gate.input2}) {
+            if (wire < 0) {
+                continue;
+            }
+            if (local(wire) >= 0) {
+                pending[i]++;
+            } else {
+                window.inputWires.push_back(wire);
+            }
+        }
+        bool isOutput = graph.primaryOutput[gate.output] || graph.fanout(gate.output) == 0;
+        for (const int* it = graph.fanoutBegin(gate.output); !isOutput && it != graph.fanoutEnd(gate.output); ++it) {
+            isOutput = windowOf[*it] != windowId;
+        }
+        drivesOutput[i] = isOutput;
+    }
+    std::sort(window.inputWires.begin(), window.inputWires.end());
+    window.inputWires.erase(std::unique(window.inputWires.begin(), window.inputWires.end()), window.inputWires.end());
+
+    // Kahn's algorithm inside the window, preferring internal gates
+    std::vector<int> ready[2];
+    for (int i = 0; i < k; ++i) {
+        if (pending[i] == 0) {
+            ready[drivesOutput[i]].push_back(i);
+        }
+    }
+    while (!ready[0].empty() || !ready[1].empty()) {
+        std::vector<int>& from = ready[0].empty() ? ready[1] : ready[0];
+        int i = from.back();
+        from.pop_back();
+        Gate gate = circuit.gate(gateIndices[i]);
+        window.addGate(gate);
+        if (drivesOutput[i]) {
+            window.outputWires.push_back(gate.output);
+        }
+        for (const int* it = graph.fanoutBegin(gate.output); it != graph.fanoutEnd(gate.output); ++it) {
+            if (windowOf[*it] != windowId) {
+                continue;
+            }
+            int j = std::lower_bound(gateIndices.begin(), gateIndices.end(), *it) - gateIndices.begin();
+            if (--pending[j] == 0) {
+                ready[drivesOutput[j]].push_back(j);
+            }
+        }
+    }
+
+    window.numInputs = window.inputWires.size();
+    window.numOutputs = window.outputWires.size();
+    stats.gates = k;
+    stats.inputs = window.numInputs;
+    stats.outputs = window.numOutputs;
+    stats.internalEdges = 0;
+    for (int i = 0; i < k; ++i) {
+        Gate gate = circuit.gate(gateIndices[i]);
+        stats.internalEdges += (local(gate.input1) >= 0) + (local(gate.input2) >= 0);
+    }
+    return window;
+}
+
+// Cuts the topological order into contiguous windows of windowSize gates.
+inline std::vector<Circuit> partitionCircuit(const Circuit& circuit, const CircuitGraph& graph, int windowSize,
+                                             std::vector<WindowStats>& stats) {
+    std::vector<Circuit> subcircuits;
+    std::vector<int> windowOf(circuit.size(), -1);
+    std::vector<int> currentGateIndices;
+    const std::vector<int>& order = graph.topoOrder;
+    for (size_t pos = 0; pos < order.size(); ++pos) {
+        int windowId = subcircuits.size();
+        windowOf[order[pos]] = windowId;
+        currentGateIndices.push_back(order[pos]);
+        if (static_cast<int>(currentGateIndices.size()) == windowSize || pos + 1 == order.size()) {
+            WindowStats windowStats;
+            subcircuits.push_back(extractWindow(circuit, graph, currentGateIndices, windowOf, windowId, windowStats));
+            stats.push_back(windowStats);
+            currentGateIndices.clear();
+        }
+    }
+    return subcircuits;
+}
+
+// Grows one window backwards from each root, taking roots in reverse
+// topological order. A driver of a window input is absorbed while the window
+// stays within maxGates gates and maxInputs inputs; drivers whose fanout is
+// already inside the window (fanout-free cones) go first, then those adding
+// the fewest new inputs. Every outside reader of a window gate must sit at or
+// above the root's level, so no path leaves a window and re-enters it.
+inline std::vector<Circuit> partitionByCones(const Circuit& circuit, const CircuitGraph& graph, int maxGates, int maxInputs,
+                                             std::vector<WindowStats>& stats) {
+    const int MAX_SCANNED_FANOUT = 64;
+    int numGates = circuit.size();
+    std::vector<int> windowOf(numGates, -1);
+    std::vector<std::vector<int>> windows;
+
+    for (auto root = graph.topoOrder.rbegin(); root != graph.topoOrder.rend(); ++root) {
+        if (windowOf[*root] >= 0) {
+            continue;
+        }
+        int windowId = windows.size();
+        int rootLevel = graph.level[*root];
+        std::vector<int> members = {*root};
+        windowOf[*root] = windowId;
+
+        auto drivenInside = [&](int wire) {
+            return wire >= 0 && graph.driver[wire] >= 0 && windowOf[graph.driver[wire]] == windowId;
+        };
+        auto isInput = [&](const std::vector<int>& inputs, int wire) {
+            return std::find(inputs.begin(), inputs.end(), wire) != inputs.end();
+        };
+
+        while (static_cast<int>(members.size()) < maxGates) {
+            std::vector<int> inputs;
+            for (int g : members) {
+                for (int wire : {circuit.gate(g).input1, circuit.gate(g).input2}) {
+                    if (wire >= 0 && !drivenInside(wire) && !isInput(inputs, wire)) {
+                        inputs.push_back(wire);
+                    }
+                }
+            }
+
+            int best = -1;
+            int bestOutside = 0;
+            int bestAdded = 0;
+            for (int wire : inputs) {
+                int d = graph.driver[wire];
+                if (d < 0 || windowOf[d] >= 0 || graph.fanout(wire) > MAX_SCANNED_FANOUT) {
+                    continue;
+                }
+                int outside = 0;
+                bool convex = true;
+                for (const int* it = graph.fanoutBegin(wire); it != graph.fanoutEnd(wire); ++it) {
+                    if (windowOf[*it] != windowId) {
+                        outside++;
+                        convex = convex && graph.level[*it] >= rootLevel;
+                    }
+                }
+                if (!convex) {
+                    continue;
+                }
+                Gate gate = circuit.gate(d);
+                int added = 0;
+                for (int in : {gate.input1, gate.input2}) {
+                    if (in >= 0 && !drivenInside(in) && !isInput(inputs, in)) {
+                        added++;
+                    }
+                }
+                if (gate.input1 >= 0 && gate.input1 == gate.input2 && !drivenInside(gate.input1) &&
+                    !isInput(inputs, gate.input1)) {
+                    added--;
+                }
+                if (static_cast<int>(inputs.size()) - 1 + added > maxInputs) {
+                    continue;
+                }
+                bool better = best < 0 || (outside == 0) > (bestOutside == 0) ||
+                              ((outside == 0) == (bestOutside == 0) && added < bestAdded);
+                if (better) {
+                    best = d;
+                    bestOutside = outside;
+                    bestAdded = added;
+                }
+            }
+            if (best < 0) {
+                break;
+            }
+            members.push_back(best);
+            windowOf[best] = windowId;
+        }
+        windows.push_back(members);
+    }
+
+    // Roots were visited from the outputs back; report windows in circuit order
+    std::vector<Circuit> subcircuits;
+    for (int id = windows.size() - 1; id >= 0; --id) {
+        WindowStats windowStats;
+        subcircuits.push_back(extractWindow(circuit, graph, windows[id], windowOf, id, windowStats));
+        stats.push_back(windowStats);
+    }
+    return subcircuits;
+}
+
+// Window as a netlist with dense local wires: the window inputs first, in
+// order, then one wire per gate output.
+inline FlatNetlist windowNetlist(const Circuit& window, std::vector<int>& inputs, std::vector<int>& outputs) {
+    std::unordered_map<int, int> local;
+    for (int wire : window.inputWires) {
+        local.emplace(wire, local.size());
+    }
+    for (int g = 0; g < window.size(); ++g) {
+        Gate gate = window.gate(g);
+        local.emplace(gate.output, local.size());
+    }
+    FlatNetlist netlist;
+    for (int g = 0; g < window.size(); ++g) {
+        Gate gate = window.gate(g);
+        int in[2];
+        int nIn = 0;
+        for (int wire : {gate.input1, gate.input2}) {
+            if (wire >= 0) {
+                in[nIn++] = local.at(wire);
+            }
+        }
+        int out = local.at(gate.output);
+        netlist.addGate(gate.type, in, nIn, &out, 1);
+    }
+    netlist.numGates = netlist.size();
+    netlist.numWires = local.size();
+    inputs.clear();
+    outputs.clear();
+    for (int wire : window.inputWires) {
+        inputs.push_back(local.at(wire));
+    }
+    for (int wire : window.outputWires) {
+        outputs.push_back(local.at(wire));
+    }
+    return netlist;
+}
+
+// Summary of the partition; with perWindow, one line per window as well.
+inline void printWindowStats(const std::vector<WindowStats>& stats, bool perWindow, std::ostream& out) {
+    WindowStats total = {0, 0, 0, 0};
+    WindowStats most = {0, 0, 0, 0};
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const WindowStats& s = stats[i];
+        if (perWindow) {
+            out << "Window " << i + 1 << ": " << s.gates << " gates, " << s.inputs << " inputs, "
+                << s.outputs << " outputs, " << s.internalEdges << " internal edges" << std::endl;
+        }
+        total.gates += s.gates;
+        total.inputs += s.inputs;
+        total.outputs += s.outputs;
+        total.internalEdges += s.internalEdges;
+        most.inputs = std::max(most.inputs, s.inputs);
+        most.outputs = std::max(most.outputs, s.outputs);
+    }
+    double n = std::max<size_t>(stats.size(), 1);
+    out << "Windows: " << stats.size() << ", avg " << total.gates / n << " gates, " << total.inputs / n
+        << " inputs (max " << most.inputs << "), " << total.outputs / n << " outputs (max " << most.outputs
+        << "), " << total.internalEdges / n << " internal edges" << std::endl;
+}
+
+#endif
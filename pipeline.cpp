@@ -0,0 +1,324 @@
+// Lowers a Bristol circuit and encodes its windows in one process, without
+// writing and re-parsing the tristate netlist. Three stages run concurrently
+// and hand work on through bounded queues:
+//
+//   lower:     Bristol gates in chunks of CHUNK_GATES, in order
+//   partition: each lowered chunk on its own, into windows numbered in order
+//   encode:    windows on numThreads workers, as ./qbf/subcircuit_N.qdimacs
+//
+// Windows never cross a chunk boundary. The Bristol netlist is in memory, so
+// the last gate reading each wire is known up front and a chunk can be
+// partitioned as soon as it is lowered: a wire is an output of the chunk if
+// a later chunk reads it or it is a primary output. Unlike the two-step
+// route, outputs are the Bristol output wires rather than the last wires of
+// the tristate file.
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "circuit.h"
+#include "partition.h"
+#include "qbfEncoder.h"
+#include "stats.h"
+#include "threadPool.h"
+#include "transform.h"
+
+const int CHUNK_GATES = 1 << 14;
+
+struct LoweredChunk {
+    int firstGate;
+    int endGate;
+    FlatNetlist netlist;
+};
+
+struct PipelineWindow {
+    int id; // 1-based, in circuit order
+    Circuit circuit;
+};
+
+// The gates of one lowered chunk as a circuit with dense wire IDs, numbered
+// in increasing global ID so sorting by wire gives the same order either
+// way. globalOf maps them back. Wires read but not driven in the chunk are
+// its inputs; wires driven in it are outputs when read after the chunk.
+// Helper wires from firstLocalWire on are only read inside their chunk; the
+// shared constants below it are read everywhere.
+inline Circuit chunkCircuit(LoweredChunk& chunk, const std::vector<int>& lastReader, int firstOutputWire,
+                            int firstLocalWire, std::vector<int>& globalOf) {
+    int numWires = lastReader.size();
+    globalOf.assign(chunk.netlist.wires.begin(), chunk.netlist.wires.end());
+    std::sort(globalOf.begin(), globalOf.end());
+    globalOf.erase(std::unique(globalOf.begin(), globalOf.end()), globalOf.end());
+    auto local = [&](int wire) {
+        return static_cast<int>(std::lower_bound(globalOf.begin(), globalOf.end(), wire) - globalOf.begin());
+    };
+
+    Circuit circuit;
+    std::vector<char> driven(globalOf.size(), 0);
+    for (int g = 0; g < chunk.netlist.size(); ++g) {
+        driven[local(chunk.netlist.outputs(g)[0])] = 1;
+    }
+    for (size_t w = 0; w < globalOf.size(); ++w) {
+        int wire = globalOf[w];
+        if (!driven[w]) {
+            circuit.inputWires.push_back(w);
+        } else if (wire < numWires ? wire >= firstOutputWire || lastReader[wire] >= chunk.endGate
+                                   : wire < firstLocalWire) {
+            circuit.outputWires.push_back(w);
+        }
+    }
+    for (int& wire : chunk.netlist.wires) {
+        wire = local(wire);
+    }
+    circuit.netlist = std::move(chunk.netlist);
+    circuit.netlist.numWires = globalOf.size();
+    circuit.numInputs = circuit.inputWires.size();
+    circuit.numOutputs = circuit.outputWires.size();
+    return circuit;
+}
+
+inline void toGlobalWires(Circuit& window, const std::vector<int>& globalOf) {
+    for (int& wire : window.netlist.wires) {
+        wire = globalOf[wire];
+    }
+    for (int& wire : window.inputWires) {
+        wire = globalOf[wire];
+    }
+    for (int& wire : window.outputWires) {
+        wire = globalOf[wire];
+    }
+}
+
+// Prints per-window logs in window order as they complete.
+class OrderedLog {
+public:
+    OrderedLog() : next_(1) {}
+
+    void add(int id, std::string text) {
+        std::lock_guard<std::mutex> guard(lock_);
+        pending_[id] = std::move(text);
+        for (auto it = pending_.find(next_); it != pending_.end(); it = pending_.find(next_)) {
+            std::cout << it->second;
+            pending_.erase(it);
+            ++next_;
+        }
+    }
+
+private:
+    std::mutex lock_;
+    int next_;
+    std::map<int, std::string> pending_;
+};
+
+int main(int argc, char* argv[]) {
+    unsigned numThreads = 0; // 0 = hardware concurrency
+    bool sharedConstants = false;
+    bool sliceWindows = false;
+    bool verboseStats = false;
+    int maxGates = 7;
+    int maxInputs = 6;
+    EncoderOptions options;
+    std::string statsTarget;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            int count;
+            if (!parseCount(argv[++i], count)) {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return 1;
+            }
+            numThreads = count;
+        } else if (arg == "--shared-consts") {
+            sharedConstants = true;
+        } else if (arg == "--partition" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "cones") {
+                sliceWindows = false;
+            } else if (mode == "slices") {
+                sliceWindows = true;
+            } else {
+                std::cerr << "Unknown partitioner: " << mode << std::endl;
+                return 1;
+            }
+        } else if (arg == "--max-gates" && i + 1 < argc) {
+            if (!parseCount(argv[++i], maxGates)) {
+                std::cerr << "Invalid value for --max-gates: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--max-inputs" && i + 1 < argc) {
+            if (!parseCount(argv[++i], maxInputs)) {
+                std::cerr << "Invalid value for --max-inputs: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--window-stats") {
+            verboseStats = true;
+        } else if (arg == "--stats") {
+            statsTarget = "json";
+        } else if (arg.compare(0, 8, "--stats=") == 0) {
+            statsTarget = arg.substr(8);
+        } else if (arg == "--amo" && i + 1 < argc) {
+            if (!parseAmoEncoding(argv[++i], options.amoEncoding)) {
+                std::cerr << "Unknown at-most-one encoding: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--input-encoding" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "pairs") {
+                options.inputEncoding = PAIRWISE_INPUTS;
+            } else if (mode == "mux") {
+                options.inputEncoding = MUX_INPUTS;
+            } else {
+                std::cerr << "Unknown input encoding: " << mode << std::endl;
+                return 1;
+            }
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 1) {
+        std::cerr << "Usage: ./pipeline [-j threads] [--shared-consts] [--partition cones|slices] [--max-gates N] [--max-inputs N] [--window-stats] [--stats[=json|file]] [--input-encoding pairs|mux] [--amo auto|pairwise|sequential|commander|product] <input_circuit_file>" << std::endl;
+        return 1;
+    }
+    if (maxGates < 1 || maxInputs < 2) {
+        std::cerr << "Window budget needs at least 1 gate and 2 inputs" << std::endl;
+        return 1;
+    }
+    if (!statsTarget.empty()) {
+        runStats().enable();
+    }
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    FlatNetlist gates;
+    {
+        ScopedPhase phase("read");
+        if (!readBristol(files[0], gates)) {
+            return 1;
+        }
+    }
+    int numOutputWires = 0;
+    for (int count : gates.outputWireCounts) {
+        numOutputWires += count;
+    }
+    int firstOutputWire = gates.numWires - numOutputWires;
+    // readBristol rejects wire IDs outside [0, numWires), so they index directly
+    std::vector<int> lastReader(gates.numWires, -1);
+    for (int g = 0; g < gates.size(); ++g) {
+        for (int j = 0; j < gates.numInputs(g); ++j) {
+            lastReader[gates.inputs(g)[j]] = g;
+        }
+    }
+
+    bool lowered = true;
+    bool partitioned = true;
+    long long numTriStateGates = 0;
+    std::vector<WindowStats> windowStats;
+    {
+        ScopedPhase phase("pipeline");
+        BoundedQueue<LoweredChunk> chunks(2);
+        BoundedQueue<PipelineWindow> windows(64 * numThreads);
+
+        // shared constant wires are driven at the start of the first chunk
+        int firstLocalWire = gates.numWires + (sharedConstants ? 2 : 0);
+        std::thread lowerStage([&] {
+            ConstantPool pool = {false, -1, -1};
+            int nextWireId = gates.numWires;
+            LoweredChunk chunk;
+            if (sharedConstants) {
+                initConstantPool(pool, nextWireId, chunk.netlist);
+            }
+            for (int first = 0; first < gates.size(); first += CHUNK_GATES) {
+                chunk.firstGate = first;
+                chunk.endGate = std::min(gates.size(), first + CHUNK_GATES);
+                for (int g = chunk.firstGate; g < chunk.endGate; ++g) {
+                    if (!lowerGate(gates.gate(g), pool, nextWireId, chunk.netlist)) {
+                        lowered = false;
+                        chunks.close();
+                        return;
+                    }
+                }
+                numTriStateGates += chunk.netlist.size();
+                chunks.push(std::move(chunk));
+                chunk = LoweredChunk();
+            }
+            chunks.close();
+        });
+
+        std::thread partitionStage([&] {
+            LoweredChunk chunk;
+            std::vector<int> globalOf;
+            int nextId = 1;
+            while (chunks.pop(chunk)) {
+                if (!partitioned) {
+                    continue; // drain, so the lower stage never blocks on a full queue
+                }
+                Circuit circuit = chunkCircuit(chunk, lastReader, firstOutputWire, firstLocalWire, globalOf);
+                CircuitGraph graph;
+                if (!buildCircuitGraph(circuit, graph)) {
+                    partitioned = false;
+                    continue;
+                }
+                std::vector<Circuit> parts = sliceWindows
+                                                 ? partitionCircuit(circuit, graph, maxGates, windowStats)
+                                                 : partitionByCones(circuit, graph, maxGates, maxInputs, windowStats);
+                for (Circuit& part : parts) {
+                    toGlobalWires(part, globalOf);
+                    windows.push(PipelineWindow{nextId++, std::move(part)});
+                }
+            }
+            windows.close();
+        });
+
+        OrderedLog logs;
+        bool collect = runStats().enabled();
+        std::vector<std::thread> encodeStage;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            encodeStage.push_back(std::thread([&] {
+                PipelineWindow window;
+                while (windows.pop(window)) {
+                    std::ostringstream log;
+                    std::string filename = "./qbf/subcircuit_" + std::to_string(window.id) + ".qdimacs";
+                    auto start = collect ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+                    QbfSize size = encodeSubcircuitAsQBF(window.circuit, filename, options, log);
+                    if (collect) {
+                        WindowRecord record;
+                        record.window = window.id;
+                        record.gates = window.circuit.size();
+                        record.inputs = window.circuit.numInputs;
+                        record.outputs = window.circuit.numOutputs;
+                        record.vars = size.vars;
+                        record.clauses = size.clauses;
+                        record.seconds =
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                        runStats().addWindow(record);
+                        runStats().count("encoded_windows");
+                        runStats().count("vars", size.vars);
+                        runStats().count("clauses", size.clauses);
+                    }
+                    log << "Subcircuit " << window.id << " has been written to " << filename << std::endl;
+                    logs.add(window.id, log.str());
+                }
+            }));
+        }
+
+        lowerStage.join();
+        partitionStage.join();
+        for (std::thread& thread : encodeStage) {
+            thread.join();
+        }
+    }
+    if (!lowered || !partitioned) {
+        return 1;
+    }
+    std::cout << "Tristate gates: " << numTriStateGates << std::endl;
+    printWindowStats(windowStats, verboseStats, std::cout);
+    runStats().count("tristate_gates", numTriStateGates);
+    runStats().count("windows", windowStats.size());
+    return runStats().write(statsTarget) ? 0 : 1;
+}
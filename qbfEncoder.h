@@ -0,0 +1,667 @@
+#ifndef QBF_ENCODER_H
+#define QBF_ENCODER_H
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cardinality.h"
+#include "circuit.h"
+#include "clauseSink.h"
+
+enum State { ZERO = 0, ONE = 1, Z = 2, X = 3 };
+
+// 2bits wire states.... since at least 3 legal states......
+struct WireVars {
+    int v1; 
+    int v2; 
+};
+
+// helper func for pari hashing, will be used in gate selection
+struct pair_hash {
+    template <class T1, class T2>
+    std::size_t operator()(const std::pair<T1, T2>& p) const {
+        auto h1 = std::hash<T1>{}(p.first);
+        auto h2 = std::hash<T2>{}(p.second);
+        return h1 ^ h2;
+    }
+};
+
+inline int getNextVarID() {
+    static int varID = 0;
+    return ++varID;
+}
+
+
+inline void addExactlyOneConstraint(const std::vector<int>& vars, AmoEncoding amoEncoding, int& nextAuxVar,
+                                    ClauseSink& sink) {
+    // At least one variable is true
+    for (int var : vars) {
+        sink.lit(var);
+    }
+    sink.end();
+
+    // At most one variable is true
+    addAtMostOne(vars, amoEncoding, nextAuxVar, sink);
+}
+
+inline void addConstGateCompatibilityConstraints(
+    int funcVar,
+    uint8_t funcType,
+    int gateOutputVar_v1, int gateOutputVar_v2,
+    ClauseSink& sink
+) {
+    if (funcType == OP_CONST_ZERO) {
+        // Clauses to enforce:
+        // -funcVar ∨ -gateOutputVar_v1
+        // -funcVar ∨ -gateOutputVar_v2
+
+        sink.clause({-funcVar, -gateOutputVar_v1});
+        sink.clause({-funcVar, -gateOutputVar_v2});
+
+    } else if (funcType == OP_CONST_ONE) {
+        // Clauses to enforce:
+        // -funcVar ∨ -gateOutputVar_v1
+        // -funcVar ∨ gateOutputVar_v2
+
+        sink.clause({-funcVar, -gateOutputVar_v1});
+        sink.clause({-funcVar, gateOutputVar_v2});
+
+    } else {
+        std::cerr << "Invalid gate type in addConstGateCompatibilityConstraints" << std::endl;
+    }
+}
+
+// This part seems incorrect??????????????????. FIXED 10.16, much better now :)
+
+inline void addBUFFERCompatibilityConstraints(
+    int funcVar, 
+    int selVar1, int selVar2,  
+    int controlVar_v1, int controlVar_v2, 
+    int dataVar_v1, int dataVar_v2, 
+    int gateOutputVar_v1, int gateOutputVar_v2, 
+    ClauseSink& sink
+) {
+    // Possible states for control and data
+    std::vector<std::tuple<int, int>> possibleStates = {
+        {1, 0}, // Z
+        {0, 0}, // 0
+        {0, 1}  // 1
+    };
+    
+    for (const auto& controlState : possibleStates) {
+        int c_v1 = std::get<0>(controlState);
+        int c_v2 = std::get<1>(controlState);
+        
+        for (const auto& dataState : possibleStates) {
+            int d_v1 = std::get<0>(dataState);
+            int d_v2 = std::get<1>(dataState);
+            
+            // Determine output based on control signal
+            int out_v1, out_v2;
+            if ( (c_v1 == 0 && c_v2 == 1) ) { // Control is 1
+                out_v1 = d_v1;
+                out_v2 = d_v2;
+            } else {
+                // Output is Z
+                out_v1 = 1;
+                out_v2 = 0;
+            }
+            
+            // Create clauses enforcing the output state
+            // For gateOutputVar_v1
+            sink.clause({-funcVar, -selVar1, -selVar2,
+                         c_v1 == 1 ? -controlVar_v1 : controlVar_v1,
+                         c_v2 == 1 ? -controlVar_v2 : controlVar_v2,
+                         d_v1 == 1 ? -dataVar_v1 : dataVar_v1,
+                         d_v2 == 1 ? -dataVar_v2 : dataVar_v2,
+                         out_v1 == 1 ? gateOutputVar_v1 : -gateOutputVar_v1});
+            
+            // For gateOutputVar_v2
+            sink.clause({-funcVar, -selVar1, -selVar2,
+                         c_v1 == 1 ? -controlVar_v1 : controlVar_v1,
+                         c_v2 == 1 ? -controlVar_v2 : controlVar_v2,
+                         d_v1 == 1 ? -dataVar_v1 : dataVar_v1,
+                         d_v2 == 1 ? -dataVar_v2 : dataVar_v2,
+                         out_v2 == 1 ? gateOutputVar_v2 : -gateOutputVar_v2});
+        }
+    }
+}
+
+inline void addJOINCompatibilityConstraints(
+    int funcVar, 
+    int selVar1, int selVar2, 
+    int inputVar1_v1, int inputVar1_v2, 
+    int inputVar2_v1, int inputVar2_v2, 
+    int gateOutputVar_v1, int gateOutputVar_v2, 
+    ClauseSink& sink
+) {
+    std::vector<std::tuple<int, int>> inputStates = {
+        {1, 0}, // Z
+        {0, 0}, // 0
+        {0, 1}  // 1
+    };
+
+    // For each combination of input states
+    for (const auto& inputState1 : inputStates) {
+        int in1_v1 = std::get<0>(inputState1);
+        int in1_v2 = std::get<1>(inputState1);
+
+        for (const auto& inputState2 : inputStates) {
+            int in2_v1 = std::get<0>(inputState2);
+            int in2_v2 = std::get<1>(inputState2);
+            int out_v1, out_v2;
+            if ( (in1_v1 == 1 && in1_v2 == 1) || (in2_v1 == 1 && in2_v2 == 1) ) {
+                continue; 
+            }
+
+            // Based on the truth table
+            if (in1_v1 == 1 && in1_v2 == 0) {
+                if (in2_v1 == 1 && in2_v2 == 0) {
+                    out_v1 = 1; // Z
+                    out_v2 = 0;
+                } else if ( (in2_v1 == 0 && in2_v2 == 0) || (in2_v1 == 0 && in2_v2 == 1) ) {
+                    out_v1 = in2_v1;
+                    out_v2 = in2_v2;
+                }
+            } else if (in1_v1 == 0 && in1_v2 == 0) {
+                if (in2_v1 == 1 && in2_v2 == 0) {
+                    out_v1 = 0;
+                    out_v2 = 0;
+                } else if (in2_v1 == 0 && in2_v2 == 0) {
+                    out_v1 = 0;
+                    out_v2 = 0;
+                } else if (in2_v1 == 0 && in2_v2 == 1) {
+                    out_v1 = 0;
+                    out_v2 = 0;
+                }
+            } else if (in1_v1 == 0 && in1_v2 == 1) {
+                if (in2_v1 == 1 && in2_v2 == 0) {
+                    out_v1 = 0;
+                    out_v2 = 1;
+                } else if (in2_v1 == 0 && in2_v2 == 0) {
+                    out_v1 = 0;
+                    out_v2 = 1;
+                } else if (in2_v1 == 0 && in2_v2 == 1) {
+                    out_v1 = 0;
+                    out_v2 = 1;
+                }
+            } else {
+                continue;
+            }
+
+            // Create clauses enforcing the output state when funcVar and selVars are true
+            // For gateOutputVar_v1
+            sink.clause({-funcVar, -selVar1, -selVar2,
+                         in1_v1 == 1 ? -inputVar1_v1 : inputVar1_v1,
+                         in1_v2 == 1 ? -inputVar1_v2 : inputVar1_v2,
+                         in2_v1 == 1 ? -inputVar2_v1 : inputVar2_v1,
+                         in2_v2 == 1 ? -inputVar2_v2 : inputVar2_v2,
+                         out_v1 == 1 ? gateOutputVar_v1 : -gateOutputVar_v1});
+
+            // For gateOutputVar_v2
+            sink.clause({-funcVar, -selVar1, -selVar2,
+                         in1_v1 == 1 ? -inputVar1_v1 : inputVar1_v1,
+                         in1_v2 == 1 ? -inputVar1_v2 : inputVar1_v2,
+                         in2_v1 == 1 ? -inputVar2_v1 : inputVar2_v1,
+                         in2_v2 == 1 ? -inputVar2_v2 : inputVar2_v2,
+                         out_v2 == 1 ? gateOutputVar_v2 : -gateOutputVar_v2});
+        }
+    }
+}
+
+
+inline void addXORCompatibilityConstraints(
+    int funcVar, 
+    int selVar1, int selVar2, 
+    int inputVar1_v1, int inputVar1_v2, 
+    int inputVar2_v1, int inputVar2_v2, 
+    int gateOutputVar_v1, int gateOutputVar_v2, 
+    ClauseSink& sink
+) {
+
+    std::vector<std::tuple<int, int>> inputStates = {
+        {1, 0}, // Z
+        {0, 0}, // 0
+        {0, 1}  // 1
+    };
+
+    // For each combination of input states
+    for (const auto& inputState1 : inputStates) {
+        int in1_v1 = std::get<0>(inputState1);
+        int in1_v2 = std::get<1>(inputState1);
+
+        for (const auto& inputState2 : inputStates) {
+            int in2_v1 = std::get<0>(inputState2);
+            int in2_v2 = std::get<1>(inputState2);
+
+            // Determine the output state based on the XOR truth table
+            int out_v1, out_v2;
+            // Handle illegal states
+            if ( (in1_v1 == 1 && in1_v2 == 1) || (in2_v1 == 1 && in2_v2 == 1) ) {
+                continue; // Skip illegal input combinations
+            }
+
+            // Based on the truth table
+            if (in1_v1 == 1 && in1_v2 == 0) {
+                if (in2_v1 == 1 && in2_v2 == 0) {
+                    out_v1 = 1; 
+                    out_v2 = 0;
+                } else if ( (in2_v1 == 0 && in2_v2 == 0) || (in2_v1 == 0 && in2_v2 == 1) ) {
+                    out_v1 = 1;
+                    out_v2 = 0; 
+                }
+            } else if ( (in1_v1 == 0 && in1_v2 == 0) || (in1_v1 == 0 && in1_v2 == 1) ) {
+                if (in2_v1 == 1 && in2_v2 == 0) {
+                    out_v1 = 1;
+                    out_v2 = 0; 
+                } else if (in2_v1 == 0 && in2_v2 == 0) {
+                    out_v1 = 0;
+                    out_v2 = 0; 
+                } else if (in2_v1 == 0 && in2_v2 == 1) {
+                    out_v1 = 0;
+                    out_v2 = 1;
+                }
+            } else {
+                continue;
+            }
+
+            // Create clauses enforcing the output state when funcVar and selVars are true
+            // For gateOutputVar_v1
+            sink.clause({-funcVar, -selVar1, -selVar2,
+                         in1_v1 == 1 ? -inputVar1_v1 : inputVar1_v1,
+                         in1_v2 == 1 ? -inputVar1_v2 : inputVar1_v2,
+                         in2_v1 == 1 ? -inputVar2_v1 : inputVar2_v1,
+                         in2_v2 == 1 ? -inputVar2_v2 : inputVar2_v2,
+                         out_v1 == 1 ? gateOutputVar_v1 : -gateOutputVar_v1});
+
+            // For gateOutputVar_v2
+            sink.clause({-funcVar, -selVar1, -selVar2,
+                         in1_v1 == 1 ? -inputVar1_v1 : inputVar1_v1,
+                         in1_v2 == 1 ? -inputVar1_v2 : inputVar1_v2,
+                         in2_v1 == 1 ? -inputVar2_v1 : inputVar2_v1,
+                         in2_v2 == 1 ? -inputVar2_v2 : inputVar2_v2,
+                         out_v2 == 1 ? gateOutputVar_v2 : -gateOutputVar_v2});
+        }
+    }
+}
+
+
+// MAIN FUNCTION for ENCODING PROCEDURE
+// -----------------------------------
+// TODO: TEST THIS FUNCTION 
+// -----------------------------------
+// TODO: COMMENTS NEEDED. DONE 10.15
+// -----------------------------------
+
+// How gate input pins are tied to their candidate wires.
+// PAIRWISE_INPUTS: function constraints for every (t1, t2) pair of selected wires, O(gates * P^2).
+// MUX_INPUTS: per-pin value variables fed by a multiplexer from the selection
+//             variables, function constraints once per gate, O(gates * P).
+enum InputEncoding { PAIRWISE_INPUTS, MUX_INPUTS };
+
+struct EncoderOptions {
+    InputEncoding inputEncoding = PAIRWISE_INPUTS;
+    AmoEncoding amoEncoding = AMO_AUTO;
+};
+
+// Size of one encoded formula.
+struct QbfSize {
+    int vars;
+    long long clauses;
+};
+
+inline QbfSize encodeSubcircuitAsQBF(const Circuit& subcircuit, const std::string& filename,
+                                     const EncoderOptions& options, std::ostream& log) {
+    ClauseSink sink;
+    if (!sink.open(filename)) {
+        std::cerr << "Cannot open the file: " << filename << std::endl;
+        exit(1);
+    }
+
+    int varCounter = 0; // Variable counter for assigning unique IDs
+
+    std::unordered_set<int> inputVars;        // Input variables (x_t)
+    std::unordered_set<int> gateValueVars;    // Gate value variables (g_t)
+    std::vector<int> selectionVars;           // Selection variables (s_{it})
+    std::vector<int> gateFunctionVars;        // Gate definition variables (f_{i,a1a2})
+    std::unordered_set<int> outputVars;       // Output variables (o_{tj})
+
+    std::unordered_map<int, WireVars> wireVarMap; // Maps wire IDs to WireVars
+    std::unordered_map<std::pair<int, int>, int, pair_hash> selectionVarMap; // Maps (gateIndex * maxNumInputPins + inputPin, t) to selection variable ID
+    std::unordered_map<std::pair<int, int>, int, pair_hash> gateFunctionVarMap; // Maps (gateIndex, opcode) to function variable ID
+
+    int n = subcircuit.numInputs;
+    log << "Number of inputs: " << n << std::endl;
+    int numOutputs = subcircuit.numOutputs;
+    log << "Number of outputs: " << numOutputs << std::endl;
+    int numGates = subcircuit.size();
+    log << "Number of gates: " << numGates << std::endl;
+    std::vector<uint8_t> possibleFunctions = {OP_XOR, OP_BUFFER, OP_JOIN, OP_CONST_ZERO, OP_CONST_ONE};
+
+    // Function to get the number of inputs for each gate type
+    // TODO: For buffer, index the control wire.
+    auto getNumInputs = [](uint8_t type) -> int {
+        switch (type) {
+            case OP_BUFFER:
+            case OP_JOIN:
+            case OP_XOR:
+                return 2;
+            case OP_CONST_ZERO:
+            case OP_CONST_ONE:
+                return 0;
+            default:
+                return 0;
+        }
+    };
+
+    // Collect wire IDs for primary inputs
+    std::vector<int> possibleInputs;
+    for (int i = 0; i < n; ++i) {
+        possibleInputs.push_back(i); // Assuming wire IDs for inputs are 0 to n-1
+        WireVars vars;
+        vars.v1 = ++varCounter;
+        inputVars.insert(vars.v1);
+        vars.v2 = ++varCounter;
+        inputVars.insert(vars.v2);
+        wireVarMap[i] = vars;
+    }
+
+    // gate outputs (gate value variables)
+    for (int i = 0; i < numGates; ++i) {
+        int gateOutputWireID = subcircuit.gate(i).output;
+        if (wireVarMap.find(gateOutputWireID) == wireVarMap.end()) {
+            WireVars vars;
+            vars.v1 = ++varCounter;
+            vars.v2 = ++varCounter;
+            gateValueVars.insert(vars.v1);
+            gateValueVars.insert(vars.v2);
+            wireVarMap[gateOutputWireID] = vars;
+        }
+        // Add gate output wire to possible inputs for subsequent gates
+        possibleInputs.push_back(gateOutputWireID);
+    }
+
+    // selection variables (s_{it})
+    int maxNumInputPins = 2; // Maximum number of inputs any gate can have, 2 by default..... Need to change for buffer
+    for (int i = 0; i < numGates; ++i) {
+        int numPins = getNumInputs(subcircuit.gate(i).type);
+        if (numPins == 0) {
+            continue; 
+        }
+        for (int inputPin = 0; inputPin < numPins; ++inputPin) {
+            for (int t = 0; t < possibleInputs.size(); ++t) {
+                int varID = ++varCounter;
+                selectionVars.push_back(varID);
+                selectionVarMap[{i * maxNumInputPins + inputPin, t}] = varID;
+            }
+        }
+    }
+
+    // Afunction variables (f_{i,a1a2})
+    for (int i = 0; i < numGates; ++i) {
+        for (const auto& funcType : possibleFunctions) {
+            int varID = ++varCounter;
+            gateFunctionVars.push_back(varID);
+            gateFunctionVarMap[{i, funcType}] = varID;
+        }
+    }
+
+    // pin value variables, MUX_INPUTS only: one WireVars per gate input pin
+    std::unordered_map<int, WireVars> pinVarMap; // Maps gateIndex * maxNumInputPins + inputPin to its value
+    if (options.inputEncoding == MUX_INPUTS) {
+        for (int i = 0; i < numGates; ++i) {
+            int numPins = getNumInputs(subcircuit.gate(i).type);
+            for (int inputPin = 0; inputPin < numPins; ++inputPin) {
+                WireVars vars;
+                vars.v1 = ++varCounter;
+                vars.v2 = ++varCounter;
+                pinVarMap[i * maxNumInputPins + inputPin] = vars;
+            }
+        }
+    }
+
+    // auxiliary variables of the at-most-one encodings, reserved here so they
+    // are part of the quantifier prefix
+    int numSelectionGroups = 0;
+    for (int i = 0; i < numGates; ++i) {
+        numSelectionGroups += getNumInputs(subcircuit.gate(i).type);
+    }
+    AmoCost selectionCost = atMostOneCost(possibleInputs.size(), options.amoEncoding);
+    AmoCost functionCost = atMostOneCost(possibleFunctions.size(), options.amoEncoding);
+    int nextAuxVar = varCounter + 1;
+    varCounter += numSelectionGroups * selectionCost.auxVars + numGates * functionCost.auxVars;
+    log << "At-most-one over " << possibleInputs.size() << " selection vars: "
+        << amoEncodingName(resolveAmoEncoding(options.amoEncoding, possibleInputs.size()))
+        << ", +" << selectionCost.auxVars << " vars, " << selectionCost.clauses << " clauses per pin"
+        << " (pairwise: " << atMostOneCost(possibleInputs.size(), AMO_PAIRWISE).clauses << " clauses)" << std::endl;
+
+    // output variables (o_{tj})
+    std::vector<int> outputWireIDs;
+    for (int i = numGates - numOutputs; i < numGates; ++i) {
+        int outputWireID = subcircuit.gate(i).output;
+        outputWireIDs.push_back(outputWireID);
+        // Outputs are already in wireVarMap
+        outputVars.insert(wireVarMap[outputWireID].v1);
+        outputVars.insert(wireVarMap[outputWireID].v2);
+    }
+
+    sink.header(varCounter);
+
+    // Universal quantification for input variables (x_t)
+    // Currently, universal quantification contains all other variables
+
+    // -------------------------------------
+    // TODO: Need verification if universal quantification is correct, NO? 10.15
+    // -------------------------------------
+
+    sink.text("a ");
+    for (int var : inputVars) {
+        sink.number(var);
+    }
+    sink.text("0\n");
+
+    // Existential quantification for other variables
+    sink.text("e ");
+    for (int var = 1; var <= varCounter; ++var) {
+        if (inputVars.find(var) == inputVars.end()) {
+            sink.number(var);
+        }
+    }
+    sink.text("0\n");
+
+    // 1. no wire in the illegal state
+    for (const auto& entry : wireVarMap) {
+        int v1 = entry.second.v1;
+        int v2 = entry.second.v2;
+        // Clause: -v1 ∨ -v2 (at least one of v1 or v2 is 0)
+        sink.clause({-v1, -v2});
+    }
+
+    // 2. exactly one selection variable is true
+    for (int i = 0; i < numGates; ++i) {
+        int numPins = getNumInputs(subcircuit.gate(i).type);
+        if (numPins == 0) {
+            continue; 
+        }
+        for (int inputPin = 0; inputPin < numPins; ++inputPin) {
+            std::vector<int> gateSelectionVars;
+            for (int t = 0; t < possibleInputs.size(); ++t) {
+                int selVar = selectionVarMap[{i * maxNumInputPins + inputPin, t}];
+                gateSelectionVars.push_back(selVar);
+            }
+            // Add constraints that exactly one selection variable is true
+            addExactlyOneConstraint(gateSelectionVars, options.amoEncoding, nextAuxVar, sink);
+        }
+    }
+
+    // 3. exactly one function is selected
+    for (int i = 0; i < numGates; ++i) {
+        std::vector<int> gateFuncVars;
+        for (const auto& funcType : possibleFunctions) {
+            int funcVar = gateFunctionVarMap[{i, funcType}];
+            gateFuncVars.push_back(funcVar);
+        }
+        // Add constraint that exactly one function variable is true
+        addExactlyOneConstraint(gateFuncVars, options.amoEncoding, nextAuxVar, sink);
+    }
+
+    // Function constraints for gate i with its pins bound to in1/in2, guarded
+    // by the selection literals (0 = unguarded). BUFFER pins are (data, control)
+    // as in the netlists written by transformCircuit.
+    auto addGateFunctionConstraints = [&](int i, int selVar1, int selVar2,
+                                          const WireVars& in1, const WireVars& in2,
+                                          const WireVars& out) {
+        for (const auto& funcType : possibleFunctions) {
+            int funcVar = gateFunctionVarMap[{i, funcType}];
+
+            if (funcType == OP_BUFFER) {
+                addBUFFERCompatibilityConstraints(
+                    funcVar, selVar1, selVar2,
+                    in2.v1, in2.v2,
+                    in1.v1, in1.v2,
+                    out.v1, out.v2,
+                    sink
+                );
+            } else if (funcType == OP_XOR) {
+                addXORCompatibilityConstraints(
+                    funcVar, selVar1, selVar2,
+                    in1.v1, in1.v2,
+                    in2.v1, in2.v2,
+                    out.v1, out.v2,
+                    sink
+                );
+            } else if (funcType == OP_JOIN) {
+                addJOINCompatibilityConstraints(
+                    funcVar, selVar1, selVar2,
+                    in1.v1, in1.v2,
+                    in2.v1, in2.v2,
+                    out.v1, out.v2,
+                    sink
+                );
+            }
+        }
+    };
+
+    // 4. gate outputs are consistent with selected inputs and functions
+    for (int i = 0; i < numGates; ++i) {
+        Gate gate = subcircuit.gate(i);
+        int gateOutputWireID = gate.output;
+        WireVars gateOutputVars = wireVarMap[gateOutputWireID];
+
+        int numPins = getNumInputs(gate.type);
+
+        if (numPins == 0) {
+            for (const auto& funcType : possibleFunctions) {
+                int funcVar = gateFunctionVarMap[{i, funcType}];
+
+                if (funcType == OP_CONST_ZERO || funcType == OP_CONST_ONE) {
+                    addConstGateCompatibilityConstraints(
+                        funcVar,
+                        funcType,
+                        gateOutputVars.v1,
+                        gateOutputVars.v2,
+                        sink
+                    );
+                }
+            }
+        } else if (numPins == 2 && options.inputEncoding == MUX_INPUTS) {
+            // Route the selected wire onto the pin variables: s_{it} -> pin == wire_t
+            int numCandidates = possibleInputs.size();
+            for (int inputPin = 0; inputPin < numPins; ++inputPin) {
+                WireVars pinVars = pinVarMap[i * maxNumInputPins + inputPin];
+                for (int t = 0; t < numCandidates; ++t) {
+                    int selVar = selectionVarMap[{i * maxNumInputPins + inputPin, t}];
+                    WireVars inputVars = wireVarMap[possibleInputs[t]];
+                    sink.clause({-selVar, -inputVars.v1, pinVars.v1});
+                    sink.clause({-selVar, inputVars.v1, -pinVars.v1});
+                    sink.clause({-selVar, -inputVars.v2, pinVars.v2});
+                    sink.clause({-selVar, inputVars.v2, -pinVars.v2});
+                }
+            }
+            addGateFunctionConstraints(i, 0, 0,
+                                       pinVarMap[i * maxNumInputPins],
+                                       pinVarMap[i * maxNumInputPins + 1],
+                                       gateOutputVars);
+        } else if (numPins == 2) {
+            for (int t1 = 0; t1 < possibleInputs.size(); ++t1) {
+                int selVar1 = selectionVarMap[{i * maxNumInputPins, t1}];
+                WireVars inputVars1 = wireVarMap[possibleInputs[t1]];
+
+                for (int t2 = 0; t2 < possibleInputs.size(); ++t2) {
+                    int selVar2 = selectionVarMap[{i * maxNumInputPins + 1, t2}];
+                    WireVars inputVars2 = wireVarMap[possibleInputs[t2]];
+
+                    addGateFunctionConstraints(i, selVar1, selVar2, inputVars1, inputVars2, gateOutputVars);
+                }
+            }
+        } 
+    }
+
+    // 5. acyclicity
+    for (int i = 0; i < numGates; ++i) {
+        int numPins = getNumInputs(subcircuit.gate(i).type);
+        if (numPins == 0) {
+            continue; 
+        }
+        for (int inputPin = 0; inputPin < numPins; ++inputPin) {
+            for (int t = 0; t < possibleInputs.size(); ++t) {
+                int inputWireID = possibleInputs[t];
+                bool invalidInput = false;
+                for (int j = i; j < numGates; ++j) {
+                    if (subcircuit.gate(j).output == inputWireID) {
+                        invalidInput = true;
+                        break;
+                    }
+                }
+                if (invalidInput) {
+                    // Add clause to prevent selection of this input
+                    int selVar = selectionVarMap[{i * maxNumInputPins + inputPin, t}];
+                    sink.clause({-selVar});
+                }
+            }
+        }
+    }
+
+    // 6. symmetry breaking
+    // Manually check acyclicity of the circuit and add symmetry breaking constraints
+    // Consecutive gates are ordered JOIN, BUFFER, XOR, CONST_ZERO, CONST_ONE.
+    auto functionRank = [](uint8_t type) -> int {
+        switch (type) {
+            case OP_JOIN:   return 0;
+            case OP_BUFFER: return 1;
+            case OP_XOR:    return 2;
+            default:        return type == OP_CONST_ZERO ? 3 : 4;
+        }
+    };
+    for (int i = 1; i < numGates; ++i) {
+        for (const auto& funcTypePrev : possibleFunctions) {
+            for (const auto& funcTypeCurr : possibleFunctions) {
+                if (functionRank(funcTypeCurr) < functionRank(funcTypePrev)) {
+                    int funcVarPrev = gateFunctionVarMap[{i - 1, funcTypePrev}];
+                    int funcVarCurr = gateFunctionVarMap[{i, funcTypeCurr}];
+                    // Add constraint: -(funcVarPrev) ∨ -(funcVarCurr)
+                    sink.clause({-funcVarPrev, -funcVarCurr});
+                }
+            }
+        }
+    }
+
+    // output: flush and patch the clause count into the header
+    if (!sink.close()) {
+        std::cerr << "Error writing the file: " << filename << std::endl;
+        exit(1);
+    }
+    QbfSize size;
+    size.vars = varCounter;
+    size.clauses = sink.numClauses();
+    return size;
+}
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+// Run statistics behind --stats: named phase timings, counters and one record
+// per encoded window, written out as JSON at exit. Until enable() is called
+// every hook reduces to one branch on a flag, so they stay in the code.
+
+inline long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct WindowRecord {
+    int window;
+    int gates;
+    int inputs;
+    int outputs;
+    long long vars;
+    long long clauses;
+    double seconds;
+};
+
+class RunStats {
+public:
+    RunStats() : enabled_(false) {}
+
+    bool enabled() const { return enabled_; }
+    void enable() { enabled_ = true; }
+
+    void addPhase(const char* name, double seconds) {
+        std::lock_guard<std::mutex> guard(lock_);
+        phases_.push_back(Phase{name, seconds});
+    }
+
+    void count(const std::string& name, long long value = 1) {
+        if (!enabled_) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock_);
+        counters_[name] += value;
+    }
+
+    void addWindow(const WindowRecord& record) {
+        std::lock_guard<std::mutex> guard(lock_);
+        windows_.push_back(record);
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\n  \"peak_rss_kb\": " << peakRssKb() << ",\n  \"phases\": [";
+        for (size_t i = 0; i < phases_.size(); ++i) {
+            out << (i ? ", " : "") << "{\"name\": \"" << phases_[i].name << "\", \"seconds\": " << phases_[i].seconds
+                << "}";
+        }
+        out << "],\n  \"counters\": {";
+        bool first = true;
+        for (const auto& counter : counters_) {
+            out << (first ? "" : ", ") << "\"" << counter.first << "\": " << counter.second;
+            first = false;
+        }
+        out << "}";
+        if (!windows_.empty()) {
+            // windows finish in any order on the pool; report them by ID and
+            // list the slowest separately
+            std::vector<WindowRecord> byId(windows_);
+            std::sort(byId.begin(), byId.end(),
+                      [](const WindowRecord& a, const WindowRecord& b) { return a.window < b.window; });
+            std::vector<WindowRecord> slowest(byId);
+            std::stable_sort(slowest.begin(), slowest.end(),
+                             [](const WindowRecord& a, const WindowRecord& b) { return a.seconds > b.seconds; });
+            slowest.resize(std::min<size_t>(slowest.size(), 10));
+            out << ",\n  \"slowest_windows\": [";
+            for (size_t i = 0; i < slowest.size(); ++i) {
+                out << (i ? ", " : "") << slowest[i].window;
+            }
+            out << "],\n  \"windows\": [";
+            for (size_t i = 0; i < byId.size(); ++i) {
+                const WindowRecord& w = byId[i];
+                out << (i ? "," : "") << "\n    {\"window\": " << w.window << ", \"gates\": " << w.gates
+                    << ", \"inputs\": " << w.inputs << ", \"outputs\": " << w.outputs << ", \"vars\": " << w.vars
+                    << ", \"clauses\": " << w.clauses << ", \"seconds\": " << w.seconds << "}";
+            }
+            out << "\n  ]";
+        }
+        out << "\n}\n";
+    }
+
+    // target is "json" for stderr, otherwise a file name.
+    bool write(const std::string& target) const {
+        if (!enabled_) {
+            return true;
+        }
+        if (target == "json") {
+            writeJson(std::cerr);
+            return true;
+        }
+        std::ofstream out(target);
+        if (!out) {
+            std::cerr << "Failed to open stats file: " << target << std::endl;
+            return false;
+        }
+        writeJson(out);
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct Phase {
+        std::string name;
+        double seconds;
+    };
+
+    bool enabled_;
+    mutable std::mutex lock_;
+    std::vector<Phase> phases_;
+    std::map<std::string, long long> counters_;
+    std::vector<WindowRecord> windows_;
+};
+
+inline RunStats& runStats() {
+    static RunStats stats;
+    return stats;
+}
+
+// Records the time from construction to destruction as one phase.
+class ScopedPhase {
+public:
+    explicit ScopedPhase(const char* name) : name_(name), enabled_(runStats().enabled()) {
+        if (enabled_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedPhase() {
+        if (enabled_) {
+            runStats().addPhase(name_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+        }
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    const char* name_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif
@@ -0,0 +1,363 @@
+#ifndef SYNTHESIS_H
+#define SYNTHESIS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include "cardinality.h"
+#include "clauseSink.h"
+#include "netlist.h"
+
+// Exact synthesis of a tristate function as a plain CNF instance: is there a
+// circuit of k gates with this truth table? The universally quantified inputs
+// are expanded over every row of the table (3^n rows over ZERO/ONE/Z), so any
+// DIMACS SAT solver can answer it. Gate i reads primary inputs or gates 0..i-1
+// only, which keeps every model acyclic.
+//
+// Variables: function f(i,t), selection s(i,p,c) and output o(k,i) variables
+// describe the circuit and are what a model is decoded from; per-row gate and
+// pin values follow, then the auxiliary variables of the at-most-one
+// constraints.
+const uint8_t SYNTHESIS_FUNCTIONS[] = {OP_XOR, OP_BUFFER, OP_JOIN, OP_CONST_ZERO, OP_CONST_ONE};
+const int NUM_SYNTHESIS_FUNCTIONS = 5;
+
+// Scalar tristate gate with the semantics of TriStateSimulator. States are
+// hi << 1 | lo: ZERO = 0, ONE = 1, Z = 2, X = 3.
+inline int triStateEval(uint8_t op, int a, int b) {
+    int ah = a >> 1, al = a & 1, bh = b >> 1, bl = b & 1;
+    switch (op) {
+        case OP_XOR: {
+            int z = ah | bh;
+            return z << 1 | ((z ^ 1) & (al ^ bl));
+        }
+        case OP_BUFFER: {
+            int on = (bh ^ 1) & bl;
+            return ((on ^ 1) | ah) << 1 | (on & (ah ^ 1) & al);
+        }
+        case OP_JOIN:       return (ah & bh) << 1 | (ah ? bl : al);
+        case OP_CONST_ZERO: return 0;
+        case OP_CONST_ONE:  return 1;
+    }
+    return 3;
+}
+
+struct SynthesisLayout {
+    int numInputs;
+    int numOutputs;
+    int numGates;
+    int rows;
+    int numVars;
+    std::vector<int> selectStart; // first s(i,p,c) of each (gate, pin)
+    int outputStart;
+    int valueStart;
+    int pinStart;
+    int auxStart;
+
+    int candidates(int i) const { return numInputs + i; }
+    int function(int i, int t) const { return 1 + i * NUM_SYNTHESIS_FUNCTIONS + t; }
+    // candidate c < numInputs is input c, otherwise gate c - numInputs
+    int select(int i, int p, int c) const { return selectStart[2 * i + p] + c; }
+    int output(int k, int i) const { return outputStart + k * numGates + i; }
+    // bit 0 is hi (v1), bit 1 is lo (v2)
+    int value(int r, int i, int bit) const { return valueStart + (r * numGates + i) * 2 + bit; }
+    int pin(int r, int i, int p, int bit) const { return pinStart + ((r * numGates + i) * 2 + p) * 2 + bit; }
+};
+
+inline SynthesisLayout synthesisLayout(int numInputs, int numOutputs, int numGates, AmoEncoding amo) {
+    SynthesisLayout layout;
+    layout.numInputs = numInputs;
+    layout.numOutputs = numOutputs;
+    layout.numGates = numGates;
+    layout.rows = 1;
+    for (int j = 0; j < numInputs; ++j) {
+        layout.rows *= 3;
+    }
+    int next = 1 + numGates * NUM_SYNTHESIS_FUNCTIONS;
+    for (int i = 0; i < numGates; ++i) {
+        for (int p = 0; p < 2; ++p) {
+            layout.selectStart.push_back(next);
+            next += layout.candidates(i);
+        }
+    }
+    layout.outputStart = next;
+    next += numOutputs * numGates;
+    layout.valueStart = next;
+    next += layout.rows * numGates * 2;
+    layout.pinStart = next;
+    next += layout.rows * numGates * 4;
+    layout.auxStart = next;
+    next += numGates * atMostOneCost(NUM_SYNTHESIS_FUNCTIONS, amo).auxVars;
+    for (int i = 0; i < numGates; ++i) {
+        next += 2 * atMostOneCost(layout.candidates(i), amo).auxVars;
+    }
+    next += numOutputs * atMostOneCost(numGates, amo).auxVars;
+    layout.numVars = next - 1;
+    return layout;
+}
+
+// table[o * rows + r] is the state of output o in row r; row r gives input j
+// the base-3 digit j of r (0 = ZERO, 1 = ONE, 2 = Z).
+inline bool writeSynthesisCNF(const std::vector<uint8_t>& table, const SynthesisLayout& layout,
+                              AmoEncoding amo, const std::string& filename) {
+    ClauseSink sink;
+    if (!sink.open(filename)) {
+        std::cerr << "Cannot open the file: " << filename << std::endl;
+        return false;
+    }
+    int n = layout.numInputs;
+    int k = layout.numGates;
+    int nextAuxVar = layout.auxStart;
+    std::vector<int> pow3(n + 1, 1);
+    for (int j = 0; j < n; ++j) {
+        pow3[j + 1] = pow3[j] * 3;
+    }
+    auto equal = [](int var, int bit) { return bit ? var : -var; };
+    sink.header(layout.numVars);
+
+    // Structure: one function per gate, one source per pin unless the gate is
+    // a constant, one driver per output, and every gate read by something
+    for (int i = 0; i < k; ++i) {
+        std::vector<int> functions;
+        for (int t = 0; t < NUM_SYNTHESIS_FUNCTIONS; ++t) {
+            functions.push_back(layout.function(i, t));
+            sink.lit(layout.function(i, t));
+        }
+        sink.end();
+        addAtMostOne(functions, amo, nextAuxVar, sink);
+        for (int p = 0; p < 2; ++p) {
+            std::vector<int> sources;
+            for (int c = 0; c < layout.candidates(i); ++c) {
+                sources.push_back(layout.select(i, p, c));
+                sink.lit(layout.select(i, p, c));
+            }
+            sink.lit(layout.function(i, 3));
+            sink.lit(layout.function(i, 4));
+            sink.end();
+            addAtMostOne(sources, amo, nextAuxVar, sink);
+        }
+    }
+    for (int o = 0; o < layout.numOutputs; ++o) {
+        std::vector<int> drivers;
+        for (int i = 0; i < k; ++i) {
+            drivers.push_back(layout.output(o, i));
+            sink.lit(layout.output(o, i));
+        }
+        sink.end();
+        addAtMostOne(drivers, amo, nextAuxVar, sink);
+    }
+    for (int i = 0; i < k; ++i) {
+        for (int later = i + 1; later < k; ++later) {
+            sink.lit(layout.select(later, 0, n + i));
+            sink.lit(layout.select(later, 1, n + i));
+        }
+        for (int o = 0; o < layout.numOutputs; ++o) {
+            sink.lit(layout.output(o, i));
+        }
+        sink.end();
+    }
+
+    // Behaviour on every row
+    for (int r = 0; r < layout.rows; ++r) {
+        for (int i = 0; i < k; ++i) {
+            for (int p = 0; p < 2; ++p) {
+                int ph = layout.pin(r, i, p, 0);
+                int pl = layout.pin(r, i, p, 1);
+                for (int c = 0; c < layout.candidates(i); ++c) {
+                    int s = layout.select(i, p, c);
+                    if (c < n) {
+                        int state = r / pow3[c] % 3;
+                        sink.clause({-s, equal(ph, state >> 1)});
+                        sink.clause({-s, equal(pl, state & 1)});
+                    } else {
+                        int vh = layout.value(r, c - n, 0);
+                        int vl = layout.value(r, c - n, 1);
+                        sink.clause({-s, -vh, ph});
+                        sink.clause({-s, vh, -ph});
+                        sink.clause({-s, -vl, pl});
+                        sink.clause({-s, vl, -pl});
+                    }
+                }
+            }
+            int oh = layout.value(r, i, 0);
+            int ol = layout.value(r, i, 1);
+            for (int t = 0; t < NUM_SYNTHESIS_FUNCTIONS; ++t) {
+                int f = layout.function(i, t);
+                uint8_t op = SYNTHESIS_FUNCTIONS[t];
+                if (op == OP_CONST_ZERO || op == OP_CONST_ONE) {
+                    int state = triStateEval(op, 0, 0);
+                    sink.clause({-f, equal(oh, state >> 1)});
+                    sink.clause({-f, equal(ol, state & 1)});
+                    continue;
+                }
+                // X never reaches a pin: inputs are ZERO/ONE/Z and no gate
+                // turns those into X, so its combinations are left open
+                for (int a = 0; a < 3; ++a) {
+                    for (int b = 0; b < 3; ++b) {
+                        int state = triStateEval(op, a, b);
+                        int guard[5] = {-f,
+                                        equal(layout.pin(r, i, 0, 0), !(a >> 1)),
+                                        equal(layout.pin(r, i, 0, 1), !(a & 1)),
+                                        equal(layout.pin(r, i, 1, 0), !(b >> 1)),
+                                        equal(layout.pin(r, i, 1, 1), !(b & 1))};
+                        for (int bit = 0; bit < 2; ++bit) {
+                            for (int g : guard) {
+                                sink.lit(g);
+                            }
+                            sink.lit(equal(layout.value(r, i, bit), bit ? state & 1 : state >> 1));
+                            sink.end();
+                        }
+                    }
+                }
+            }
+        }
+        for (int o = 0; o < layout.numOutputs; ++o) {
+            int state = table[static_cast<size_t>(o) * layout.rows + r];
+            for (int i = 0; i < k; ++i) {
+                sink.clause({-layout.output(o, i), equal(layout.value(r, i, 0), state >> 1)});
+                sink.clause({-layout.output(o, i), equal(layout.value(r, i, 1), state & 1)});
+            }
+        }
+    }
+    if (!sink.close()) {
+        std::cerr << "Error writing the file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Circuit of a model: inputs are wires 0..n-1 and gate i drives wire n + i.
+// Gates that no output depends on are dropped and the rest renumbered.
+inline void decodeSynthesis(const std::vector<char>& model, const SynthesisLayout& layout,
+                            FlatNetlist& netlist, std::vector<int>& outputs) {
+    int n = layout.numInputs;
+    int k = layout.numGates;
+    auto isTrue = [&](int var) { return var < static_cast<int>(model.size()) && model[var]; };
+    std::vector<uint8_t> ops(k, OP_CONST_ZERO);
+    std::vector<int> pins(2 * k, -1);
+    for (int i = 0; i < k; ++i) {
+        for (int t = 0; t < NUM_SYNTHESIS_FUNCTIONS; ++t) {
+            if (isTrue(layout.function(i, t))) {
+                ops[i] = SYNTHESIS_FUNCTIONS[t];
+                break;
+            }
+        }
+        for (int p = 0; p < 2; ++p) {
+            for (int c = 0; c < layout.candidates(i); ++c) {
+                if (isTrue(layout.select(i, p, c))) {
+                    pins[2 * i + p] = c;
+                    break;
+                }
+            }
+        }
+    }
+    std::vector<int> driverOf(layout.numOutputs, 0);
+    std::vector<char> live(k, 0);
+    for (int o = 0; o < layout.numOutputs; ++o) {
+        for (int i = 0; i < k; ++i) {
+            if (isTrue(layout.output(o, i))) {
+                driverOf[o] = i;
+                break;
+            }
+        }
+        live[driverOf[o]] = 1;
+    }
+    for (int i = k - 1; i >= 0; --i) {
+        if (!live[i] || ops[i] == OP_CONST_ZERO || ops[i] == OP_CONST_ONE) {
+            continue;
+        }
+        for (int p = 0; p < 2; ++p) {
+            if (pins[2 * i + p] >= n) {
+                live[pins[2 * i + p] - n] = 1;
+            }
+        }
+    }
+
+    std::vector<int> wire(n + k, -1);
+    for (int j = 0; j < n; ++j) {
+        wire[j] = j;
+    }
+    netlist = FlatNetlist();
+    int next = n;
+    for (int i = 0; i < k; ++i) {
+        if (!live[i]) {
+            continue;
+        }
+        wire[n + i] = next++;
+        int in[2];
+        int nIn = 0;
+        if (ops[i] != OP_CONST_ZERO && ops[i] != OP_CONST_ONE) {
+            in[nIn++] = wire[pins[2 * i]];
+            in[nIn++] = wire[pins[2 * i + 1]];
+        }
+        netlist.addGate(ops[i], in, nIn, &wire[n + i], 1);
+    }
+    netlist.numGates = netlist.size();
+    netlist.numWires = next;
+    outputs.clear();
+    for (int o = 0; o < layout.numOutputs; ++o) {
+        outputs.push_back(wire[n + driverOf[o]]);
+    }
+}
+
+enum SolverResult { SOLVER_UNKNOWN = 0, SOLVER_SAT = 10, SOLVER_UNSAT = 20 };
+
+// Runs a SAT solver that follows the competition output format ("s ..." and
+// "v ..." lines on stdout, exit code 10/20). A "{}" in the command is replaced
+// by the CNF file name, otherwise the name is appended.
+inline SolverResult runSatSolver(const std::string& command, const std::string& cnfFile, int numVars,
+                                 std::vector<char>& model) {
+    std::string line = command;
+    size_t slot = line.find("{}");
+    if (slot != std::string::npos) {
+        line.replace(slot, 2, cnfFile);
+    } else {
+        line += " " + cnfFile;
+    }
+    FILE* pipe = popen(line.c_str(), "r");
+    if (!pipe) {
+        std::cerr << "Cannot run solver: " << line << std::endl;
+        return SOLVER_UNKNOWN;
+    }
+    model.assign(numVars + 1, 0);
+    SolverResult result = SOLVER_UNKNOWN;
+    char buffer[1 << 16];
+    std::string pending;
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        pending += buffer;
+        if (pending.empty() || pending.back() != '\n') {
+            continue;
+        }
+        if (pending.compare(0, 2, "s ") == 0) {
+            if (pending.find("UNSATISFIABLE") != std::string::npos) {
+                result = SOLVER_UNSAT;
+            } else if (pending.find("SATISFIABLE") != std::string::npos) {
+                result = SOLVER_SAT;
+            }
+        } else if (pending[0] == 'v' || pending[0] == 'V') {
+            std::istringstream literals(pending.substr(1));
+            int literal;
+            while (literals >> literal) {
+                if (literal > 0 && literal <= numVars) {
+                    model[literal] = 1;
+                }
+            }
+        }
+        pending.clear();
+    }
+    int status = pclose(pipe);
+    if (result == SOLVER_UNKNOWN && WIFEXITED(status)) {
+        if (WEXITSTATUS(status) == SOLVER_UNSAT) {
+            result = SOLVER_UNSAT;
+        }
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Parses a command-line count such as the -j thread count: the whole
+// argument must be a decimal integer in [0, INT_MAX].
+inline bool parseCount(const char* text, int& value) {
+    char* end;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < 0 || parsed > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// Runs body(i) for every i in [0, n) on numThreads workers. Each worker
+// starts with an equal contiguous slice and takes indices from its front;
+// an idle worker steals the back half of the fullest remaining slice, so a
+// few expensive items cannot leave the other workers waiting.
+inline void parallelFor(int n, unsigned numThreads, const std::function<void(int)>& body) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min<unsigned>(numThreads, std::max(n, 1));
+    if (numThreads <= 1) {
+        for (int i = 0; i < n; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    struct Slice {
+        std::mutex lock;
+        int begin;
+        int end;
+    };
+    std::vector<Slice> slices(numThreads);
+    for (unsigned t = 0; t < numThreads; ++t) {
+        slices[t].begin = static_cast<int>(static_cast<long long>(n) * t / numThreads);
+        slices[t].end = static_cast<int>(static_cast<long long>(n) * (t + 1) / numThreads);
+    }
+
+    auto popOwn = [&](unsigned t, int& index) {
+        std::lock_guard<std::mutex> guard(slices[t].lock);
+        if (slices[t].begin >= slices[t].end) {
+            return false;
+        }
+        index = slices[t].begin++;
+        return true;
+    };
+
+    auto steal = [&](unsigned t) {
+        unsigned victim = t;
+        int most = 0;
+        for (unsigned v = 0; v < numThreads; ++v) {
+            std::lock_guard<std::mutex> guard(slices[v].lock);
+            if (slices[v].end - slices[v].begin > most) {
+                most = slices[v].end - slices[v].begin;
+                victim = v;
+            }
+        }
+        if (victim == t) {
+            return false;
+        }
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> guard(slices[victim].lock);
+            int remaining = slices[victim].end - slices[victim].begin;
+            if (remaining <= 0) {
+                return true;
+            }
+            end = slices[victim].end;
+            begin = end - (remaining + 1) / 2;
+            slices[victim].end = begin;
+        }
+        std::lock_guard<std::mutex> guard(slices[t].lock);
+        slices[t].begin = begin;
+        slices[t].end = end;
+        return true;
+    };
+
+    auto worker = [&](unsigned t) {
+        int index;
+        for (;;) {
+            if (popOwn(t, index)) {
+                body(index);
+            } else if (!steal(t)) {
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; ++t) {
+        threads.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// FIFO between pipeline stages holding at most capacity items: push blocks
+// while it is full, pop while it is empty. Once close() is called, pop
+// drains what is left and then returns false.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)), closed_(false) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(lock_);
+        notFull_.wait(lock, [&] { return items_.size() < capacity_; });
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(lock_);
+        notEmpty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> guard(lock_);
+        closed_ = true;
+        notEmpty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    std::mutex lock_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+#endif
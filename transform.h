@@ -0,0 +1,778 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bristolParser.h"
+#include "circuit.h"
+#include "stats.h"
+#include "threadPool.h"
+
+// Wires driven by the shared CONST_ONE/CONST_ZERO gates. When shared is
+// false every lowered gate emits its own constants instead.
+struct ConstantPool {
+    bool shared;
+    int constOneWire;
+    int constZeroWire;
+};
+
+// Appends a two-input tristate gate.
+inline void emitGate(FlatNetlist& triState, uint8_t op, int a, int b, int output) {
+    int in[2] = {a, b};
+    triState.addGate(op, in, 2, &output, 1);
+}
+
+inline void emitConst(FlatNetlist& triState, uint8_t op, int output) {
+    triState.addGate(op, nullptr, 0, &output, 1);
+}
+
+// Allocates the two shared constant wires and emits their gates.
+inline void initConstantPool(ConstantPool& pool, int& nextWireId, FlatNetlist& triState) {
+    pool.shared = true;
+    pool.constOneWire = nextWireId++;
+    pool.constZeroWire = nextWireId++;
+    emitConst(triState, OP_CONST_ONE, pool.constOneWire);
+    emitConst(triState, OP_CONST_ZERO, pool.constZeroWire);
+}
+
+// Tristate gates, fresh wires and wire pins lowerGate emits, summed over
+// some range of input gates.
+struct LoweredSize {
+    long long gates;
+    long long wires;
+    long long pins;
+};
+
+// Adds the output lowerGate emits for one gate to size.
+inline bool loweredSize(const GateRecord& gate, const ConstantPool& pool, LoweredSize& size) {
+    int constGates = pool.shared ? 0 : 1;
+    switch (gate.opcode) {
+        case OP_XOR:
+            size.gates += 1;
+            size.pins += gate.numInputs + 1;
+            return true;
+        case OP_AND:
+            size.gates += 4 + 2 * constGates;
+            size.wires += 3 + 2 * constGates;
+            size.pins += 12 + 2 * constGates;
+            return true;
+        case OP_INV:
+        case OP_EQ:
+        case OP_EQW:
+            size.gates += 1 + constGates;
+            size.wires += constGates;
+            size.pins += 3 + constGates;
+            return true;
+        case OP_MAND:
+            size.gates += (4LL + 2 * constGates) * (gate.numInputs / 2);
+            size.wires += (3LL + 2 * constGates) * (gate.numInputs / 2);
+            size.pins += (12LL + 2 * constGates) * (gate.numInputs / 2);
+            return true;
+        default:
+            std::cerr << "Unsupported gate type: " << opcodeName(gate.opcode) << std::endl;
+            return false;
+    }
+}
+
+// Counters for --stats: input gates lowered per type, tristate gates
+// written and helper wires allocated.
+inline void recordLoweringStats(const long long* gatesPerType, long long numTriStateGates, long long numNewWires) {
+    for (int op = 0; op < OP_INVALID; ++op) {
+        if (gatesPerType[op] > 0) {
+            runStats().count(std::string("lowered.") + opcodeName(op), gatesPerType[op]);
+        }
+    }
+    runStats().count("tristate_gates", numTriStateGates);
+    runStats().count("wires_allocated", numNewWires);
+}
+
+// output = AND(x, y) as JOIN(BUFFER(x, y), BUFFER(0, NOT y)).
+inline void lowerAndLane(int x, int y, int output, const ConstantPool& pool,
+                         int& nextWireId, FlatNetlist& triState) {
+    int not_y_wire = nextWireId++;
+    int const_one_wire = pool.shared ? pool.constOneWire : nextWireId++;
+    int const_zero_wire = pool.shared ? pool.constZeroWire : nextWireId++;
+    int buffer1_output = nextWireId++;
+    int buffer0_output = nextWireId++;
+
+    if (!pool.shared) {
+        emitConst(triState, OP_CONST_ONE, const_one_wire);
+    }
+    emitGate(triState, OP_XOR, y, const_one_wire, not_y_wire);
+    if (!pool.shared) {
+        emitConst(triState, OP_CONST_ZERO, const_zero_wire);
+    }
+    emitGate(triState, OP_BUFFER, x, y, buffer1_output);
+    emitGate(triState, OP_BUFFER, const_zero_wire, not_y_wire, buffer0_output);
+    emitGate(triState, OP_JOIN, buffer1_output, buffer0_output, output);
+}
+
+// Returns the CONST_ONE wire for INV/EQ lowering, emitting a private one
+// unless the pool is shared.
+inline int constOneFor(const ConstantPool& pool, int& nextWireId, FlatNetlist& triState) {
+    if (pool.shared) {
+        return pool.constOneWire;
+    }
+    int constOneWire = nextWireId++;
+    emitConst(triState, OP_CONST_ONE, constOneWire);
+    return constOneWire;
+}
+
+inline bool lowerGate(const GateRecord& gate, const ConstantPool& pool,
+                      int& nextWireId, FlatNetlist& triState) {
+    int numInputs = gate.numInputs;
+    int numOutputs = gate.numOutputs;
+    const int* inputWires = gate.inputs;
+    const int* outputWires = gate.outputs;
+    switch (gate.opcode) {
+        case OP_XOR:
+            triState.addGate(OP_XOR, inputWires, numInputs, outputWires, 1);
+            return true;
+        case OP_AND:
+            if (numInputs != 2 || numOutputs != 1) {
+                std::cerr << "AND gate with incorrect number of inputs/outputs." << std::endl;
+                return false;
+            }
+            lowerAndLane(inputWires[0], inputWires[1], outputWires[0], pool, nextWireId, triState);
+            return true;
+        case OP_INV:
+            if (numInputs != 1 || numOutputs != 1) {
+                std::cerr << "INV gate with incorrect number of inputs/outputs." << std::endl;
+                return false;
+            }
+            emitGate(triState, OP_XOR, inputWires[0], constOneFor(pool, nextWireId, triState),
+                     outputWires[0]);
+            return true;
+        case OP_EQ:
+        case OP_EQW:
+            if (numInputs != 1 || numOutputs != 1) {
+                std::cerr << "EQ/EQW gate with incorrect number of inputs/outputs." << std::endl;
+                return false;
+            }
+            emitGate(triState, OP_BUFFER, inputWires[0], constOneFor(pool, nextWireId, triState),
+                     outputWires[0]);
+            return true;
+        case OP_MAND: {
+            if (numInputs % 2 != 0 || numOutputs != (numInputs / 2)) {
+                std::cerr << "MAND gate with incorrect number of inputs/outputs." << std::endl;
+                return false;
+            }
+            int n = numInputs / 2;
+            for (int i = 0; i < n; ++i) {
+                lowerAndLane(inputWires[i], inputWires[i + n], outputWires[i], pool, nextWireId, triState);
+            }
+            return true;
+        }
+        default:
+            std::cerr << "Unsupported gate type: " << opcodeName(gate.opcode) << std::endl;
+            return false;
+    }
+}
+
+// Lowers a Bristol netlist into triState on numThreads workers (0 = all
+// cores). The only state shared between gates is the next free wire ID, and
+// loweredSize gives each gate's gate, wire and pin counts up front, so a
+// counting pass per chunk of input gates and a prefix sum over the chunks
+// fix where every chunk's gates, helper wires and pins go. Chunks are then
+// lowered independently, each into a small local netlist that is copied to
+// its slot in the preallocated arrays. The result is identical to lowering
+// the gates one after another.
+inline bool transformCircuit(const FlatNetlist& gates, FlatNetlist& triState, bool sharedConstants = false,
+                             unsigned numThreads = 0) {
+    const int chunkGates = 1 << 16;
+    int numChunks = (gates.size() + chunkGates - 1) / chunkGates;
+    ConstantPool pool = {sharedConstants, -1, -1};
+    bool collect = runStats().enabled();
+
+    // chunk c starts at offsets[c]; offsets[numChunks] is the total
+    std::vector<LoweredSize> offsets(numChunks + 1, LoweredSize{0, 0, 0});
+    std::vector<long long> gatesPerType(collect ? numChunks * (OP_INVALID + 1) : 0, 0);
+    std::vector<char> failed(numChunks, 0);
+    parallelFor(numChunks, numThreads, [&](int c) {
+        int end = std::min(gates.size(), (c + 1) * chunkGates);
+        for (int idx = c * chunkGates; idx < end; ++idx) {
+            if (!loweredSize(gates.gate(idx), pool, offsets[c + 1])) {
+                failed[c] = 1;
+                return;
+            }
+            if (collect) {
+                gatesPerType[c * (OP_INVALID + 1) + gates.opcodes[idx]]++;
+            }
+        }
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        return false;
+    }
+    offsets[0] = sharedConstants ? LoweredSize{2, 2, 2} : LoweredSize{0, 0, 0};
+    for (int c = 0; c < numChunks; ++c) {
+        offsets[c + 1].gates += offsets[c].gates;
+        offsets[c + 1].wires += offsets[c].wires;
+        offsets[c + 1].pins += offsets[c].pins;
+    }
+    const LoweredSize& total = offsets[numChunks];
+    if (collect) {
+        long long perType[OP_INVALID + 1] = {};
+        for (size_t i = 0; i < gatesPerType.size(); ++i) {
+            perType[i % (OP_INVALID + 1)] += gatesPerType[i];
+        }
+        recordLoweringStats(perType, total.gates, total.wires);
+    }
+
+    triState.clear();
+    triState.opcodes.resize(total.gates);
+    triState.pinOffsets.resize(2 * total.gates + 1);
+    triState.wires.resize(total.pins);
+    triState.inputWireCounts = gates.inputWireCounts;
+    triState.outputWireCounts = gates.outputWireCounts;
+
+    pool.shared = false;
+    if (sharedConstants) {
+        FlatNetlist constants;
+        int nextWireId = gates.numWires;
+        initConstantPool(pool, nextWireId, constants);
+        std::copy(constants.opcodes.begin(), constants.opcodes.end(), triState.opcodes.begin());
+        std::copy(constants.pinOffsets.begin(), constants.pinOffsets.end(), triState.pinOffsets.begin());
+        std::copy(constants.wires.begin(), constants.wires.end(), triState.wires.begin());
+    }
+
+    parallelFor(numChunks, numThreads, [&](int c) {
+        const LoweredSize& base = offsets[c];
+        FlatNetlist local;
+        local.reserve(offsets[c + 1].gates - base.gates, offsets[c + 1].pins - base.pins);
+        int nextWireId = static_cast<int>(gates.numWires + base.wires);
+        int end = std::min(gates.size(), (c + 1) * chunkGates);
+        for (int idx = c * chunkGates; idx < end; ++idx) {
+            if (!lowerGate(gates.gate(idx), pool, nextWireId, local)) {
+                failed[c] = 1;
+                return;
+            }
+        }
+        std::copy(local.opcodes.begin(), local.opcodes.end(), triState.opcodes.begin() + base.gates);
+        std::copy(local.wires.begin(), local.wires.end(), triState.wires.begin() + base.pins);
+        uint32_t* pinOffsets = triState.pinOffsets.data() + 2 * base.gates;
+        for (size_t k = 1; k < local.pinOffsets.size(); ++k) {
+            pinOffsets[k] = static_cast<uint32_t>(base.pins + local.pinOffsets[k]);
+        }
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        return false;
+    }
+
+    triState.numGates = triState.size();
+    triState.numWires = static_cast<int>(gates.numWires + total.wires);
+    return true;
+}
+
+// Renumbers the helper wires (IDs >= numWires) still driven in kept densely
+// from numWires, in gate order, and sets the gate and wire counts.
+inline void compactHelperWires(FlatNetlist& kept, int numWires, int oldNumWires) {
+    std::vector<int> dense(oldNumWires, -1);
+    int nextWireId = numWires;
+    for (int g = 0; g < kept.size(); ++g) {
+        int output = kept.outputs(g)[0];
+        if (output >= numWires) {
+            dense[output] = nextWireId++;
+        }
+    }
+    for (int& wire : kept.wires) {
+        if (wire >= numWires) {
+            wire = dense[wire];
+        }
+    }
+    kept.numGates = kept.size();
+    kept.numWires = nextWireId;
+}
+
+struct StrashKey {
+    int type;
+    int a;
+    int b;
+
+    bool operator==(const StrashKey& other) const {
+        return type == other.type && a == other.a && b == other.b;
+    }
+};
+
+struct StrashKeyHash {
+    std::size_t operator()(const StrashKey& key) const {
+        uint64_t h = static_cast<uint32_t>(key.a) * 0x9E3779B97F4A7C15ULL;
+        h ^= (static_cast<uint64_t>(static_cast<uint32_t>(key.b)) << 8 | key.type) * 0xC2B2AE3D27D4EB4FULL;
+        return static_cast<std::size_t>(h ^ (h >> 29));
+    }
+};
+
+// Structural hashing: merges gates with the same type and (renamed) inputs,
+// in one pass over the topologically ordered netlist. XOR and JOIN operands
+// are put in canonical order; swapping JOIN operands is only sound because
+// the lowering never drives both JOIN inputs at once. Gates driving primary
+// outputs are kept so output wire IDs do not change. Surviving helper wires
+// (IDs >= numWires) are then renumbered densely and numWires updated.
+inline void strashCircuit(FlatNetlist& triState, int numWires, int numOutputWires) {
+    std::vector<int> rename(triState.numWires);
+    for (int w = 0; w < triState.numWires; ++w) {
+        rename[w] = w;
+    }
+    int firstOutputWire = numWires - numOutputWires;
+
+    std::unordered_map<StrashKey, int, StrashKeyHash> table;
+    table.reserve(triState.size());
+
+    FlatNetlist kept;
+    kept.reserve(triState.size(), triState.wires.size());
+    kept.inputWireCounts = triState.inputWireCounts;
+    kept.outputWireCounts = triState.outputWireCounts;
+    int in[2];
+    for (int g = 0; g < triState.size(); ++g) {
+        int numInputs = triState.numInputs(g);
+        for (int j = 0; j < numInputs; ++j) {
+            in[j] = rename[triState.inputs(g)[j]];
+        }
+        int output = triState.outputs(g)[0];
+        StrashKey key;
+        key.type = triState.opcodes[g];
+        key.a = numInputs > 0 ? in[0] : -1;
+        key.b = numInputs > 1 ? in[1] : -1;
+        if ((key.type == OP_XOR || key.type == OP_JOIN) && key.b < key.a) {
+            std::swap(key.a, key.b);
+        }
+
+        bool isOutput = output >= firstOutputWire && output < numWires;
+        auto found = table.find(key);
+        if (found != table.end() && !isOutput) {
+            rename[output] = found->second;
+            continue;
+        }
+        if (found == table.end()) {
+            table.emplace(key, output);
+        }
+        kept.addGate(triState.opcodes[g], in, numInputs, &output, 1);
+    }
+
+    compactHelperWires(kept, numWires, triState.numWires);
+    triState = std::move(kept);
+}
+
+// States a wire may take during simplifyCircuit, one bit each.
+enum StateMask : uint8_t {
+    MAY_ZERO = 1,
+    MAY_ONE = 2,
+    MAY_Z = 4,
+    MAY_BINARY = MAY_ZERO | MAY_ONE,
+    MAY_ANY = MAY_ZERO | MAY_ONE | MAY_Z
+};
+
+// XOR is Z when either input is; sameInput marks XOR(a, a).
+inline uint8_t xorStates(uint8_t a, uint8_t b, bool sameInput) {
+    uint8_t out = (a | b) & MAY_Z;
+    if (sameInput) {
+        return out | ((a & MAY_BINARY) ? MAY_ZERO : 0);
+    }
+    if (((a & MAY_ZERO) && (b & MAY_ZERO)) || ((a & MAY_ONE) && (b & MAY_ONE))) {
+        out |= MAY_ZERO;
+    }
+    if (((a & MAY_ZERO) && (b & MAY_ONE)) || ((a & MAY_ONE) && (b & MAY_ZERO))) {
+        out |= MAY_ONE;
+    }
+    return out;
+}
+
+// BUFFER passes data when control is ONE and is Z otherwise.
+inline uint8_t bufferStates(uint8_t data, uint8_t control) {
+    return ((control & MAY_ONE) ? data : 0) | ((control & (MAY_ZERO | MAY_Z)) ? MAY_Z : 0);
+}
+
+// JOIN returns its first input unless that is Z, then its second.
+inline uint8_t joinStates(uint8_t a, uint8_t b) {
+    return (a & MAY_BINARY) | ((a & MAY_Z) ? b : 0);
+}
+
+// Constant folding, buffer forwarding and dead-gate elimination on a
+// tristate netlist, run before anything is handed to the SAT encoder.
+//
+// One pass over the gates in topological order gives each the set of states
+// its output may take, with primary inputs binary; a gate reading a wire that
+// is neither an input nor driven is an error. A gate whose set is
+// a single binary value becomes a CONST gate. A gate that provably passes one
+// input through, such as XOR(a, 0), BUFFER(d, 1), JOIN(a, b) with a never Z,
+// or any gate fed an always-Z wire that propagates, is bypassed: its readers
+// read that input instead. A BUFFER whose control is never ONE is reduced to
+// BUFFER(c, c), dropping its data cone. Sets lose correlation between wires,
+// so JOIN(BUFFER(_, c), BUFFER(_, NOT c)) with binary c, the AND lowering, is
+// evaluated per value of c instead. Gates no output depends on are then
+// swept. Output wire IDs are kept and surviving helper wires are renumbered
+// densely as in strashCircuit. keepUnreadWires also keeps every wire nobody
+// reads, for callers that, like the partitioner, treat those as outputs.
+inline bool simplifyCircuit(FlatNetlist& triState, int numWires, int numOutputWires,
+                            bool keepUnreadWires = false) {
+    int numInputs = 0;
+    for (int count : triState.inputWireCounts) {
+        numInputs += count;
+    }
+    int firstOutputWire = numWires - numOutputWires;
+
+    std::vector<int> inputWires(numInputs);
+    for (int w = 0; w < numInputs; ++w) {
+        inputWires[w] = w;
+    }
+    std::vector<int> outputWires(numOutputWires);
+    for (int k = 0; k < numOutputWires; ++k) {
+        outputWires[k] = firstOutputWire + k;
+    }
+    CircuitGraph graph;
+    if (!buildCircuitGraph(triState, inputWires, outputWires, graph)) {
+        return false;
+    }
+    if (static_cast<int>(graph.topoOrder.size()) != triState.size()) {
+        std::cerr << "Tristate netlist has a cycle; " << triState.size() - graph.topoOrder.size()
+                  << " gates could not be simplified." << std::endl;
+        return false;
+    }
+    const std::vector<int>& driver = graph.driver;
+    for (int g = 0; g < triState.size(); ++g) {
+        for (int j = 0; j < triState.numInputs(g); ++j) {
+            int wire = triState.inputs(g)[j];
+            if (wire >= numInputs && driver[wire] < 0) {
+                std::cerr << "Gate " << g << " reads wire " << wire
+                          << ", which is neither an input nor driven." << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // Every wire read is now an input or set before its readers are visited
+    std::vector<uint8_t> states(triState.numWires, MAY_ANY);
+    std::fill(states.begin(), states.begin() + std::min(numInputs, triState.numWires), MAY_BINARY);
+    std::vector<int> alias(triState.numWires);
+    for (int w = 0; w < triState.numWires; ++w) {
+        alias[w] = w;
+    }
+
+    // NOT c as written by the lowering: XOR(c, k) with k always ONE
+    auto isNegationOf = [&](int wire, int c) {
+        int g = driver[wire];
+        if (g < 0 || triState.opcodes[g] != OP_XOR) {
+            return false;
+        }
+        const int* in = triState.inputs(g);
+        return (in[0] == c && states[in[1]] == MAY_ONE) || (in[1] == c && states[in[0]] == MAY_ONE);
+    };
+    // States of JOIN(BUFFER(da, c), BUFFER(db, NOT c)) with c never Z:
+    // exactly one buffer drives, so the JOIN is da or db depending on c
+    auto complementaryJoinStates = [&](int a, int b, uint8_t& out) {
+        int ga = driver[a];
+        int gb = driver[b];
+        if (ga < 0 || gb < 0 || triState.opcodes[ga] != OP_BUFFER || triState.opcodes[gb] != OP_BUFFER) {
+            return false;
+        }
+        uint8_t da = states[triState.inputs(ga)[0]];
+        uint8_t db = states[triState.inputs(gb)[0]];
+        int ca = triState.inputs(ga)[1];
+        int cb = triState.inputs(gb)[1];
+        if ((states[ca] & MAY_Z) == 0 && isNegationOf(cb, ca)) {
+            out = ((states[ca] & MAY_ONE) ? da : 0) | ((states[ca] & MAY_ZERO) ? db : 0);
+            return true;
+        }
+        if ((states[cb] & MAY_Z) == 0 && isNegationOf(ca, cb)) {
+            out = ((states[cb] & MAY_ONE) ? db : 0) | ((states[cb] & MAY_ZERO) ? da : 0);
+            return true;
+        }
+        return false;
+    };
+
+    // Any topological order works: a gate only looks at its drivers' results
+    long long numFolded = 0;
+    long long numForwarded = 0;
+    for (int g : graph.topoOrder) {
+        uint8_t op = triState.opcodes[g];
+        int* in = triState.wires.data() + triState.pinOffsets[2 * g];
+        int numGateInputs = triState.numInputs(g);
+        for (int j = 0; j < numGateInputs; ++j) {
+            in[j] = alias[in[j]];
+        }
+        int output = triState.outputs(g)[0];
+
+        uint8_t a = numGateInputs > 0 ? states[in[0]] : 0;
+        uint8_t b = numGateInputs > 1 ? states[in[1]] : 0;
+        uint8_t out = MAY_ANY;
+        int forward = -1;
+        switch (op) {
+            case OP_CONST_ZERO:
+                out = MAY_ZERO;
+                break;
+            case OP_CONST_ONE:
+                out = MAY_ONE;
+                break;
+            case OP_XOR:
+                if (numGateInputs != 2) {
+                    break;
+                }
+                out = xorStates(a, b, in[0] == in[1]);
+                if (b == MAY_ZERO || a == MAY_Z) {
+                    forward = in[0];
+                } else if (a == MAY_ZERO || b == MAY_Z) {
+                    forward = in[1];
+                }
+                break;
+            case OP_BUFFER:
+                if (numGateInputs != 2) {
+                    break;
+                }
+                out = bufferStates(a, b);
+                if (b == MAY_ONE || a == MAY_Z) {
+                    forward = in[0];
+                } else if (b == MAY_Z) {
+                    forward = in[1];
+                } else if ((b & MAY_ONE) == 0) {
+                    in[0] = in[1];
+                }
+                break;
+            case OP_JOIN:
+                if (numGateInputs != 2) {
+                    break;
+                }
+                out = joinStates(a, b);
+                uint8_t exact;
+                if (complementaryJoinStates(in[0], in[1], exact)) {
+                    out &= exact;
+                }
+                if ((a & MAY_Z) == 0 || b == MAY_Z) {
+                    forward = in[0];
+                } else if (a == MAY_Z) {
+                    forward = in[1];
+                }
+                break;
+            default:
+                break;
+        }
+        states[output] = out;
+
+        bool isConstant = op == OP_CONST_ZERO || op == OP_CONST_ONE;
+        if (!isConstant && (out == MAY_ZERO || out == MAY_ONE)) {
+            triState.opcodes[g] = out == MAY_ZERO ? OP_CONST_ZERO : OP_CONST_ONE;
+            ++numFolded;
+        } else if (forward >= 0) {
+            alias[output] = forward;
+            ++numForwarded;
+        }
+    }
+
+    // Sweep: keep the gates some output still depends on
+    std::vector<char> live(triState.size(), 0);
+    std::vector<int> stack;
+    for (int k = 0; k < numOutputWires; ++k) {
+        stack.push_back(firstOutputWire + k);
+    }
+    if (keepUnreadWires) {
+        for (int w = 0; w < graph.numWires; ++w) {
+            if (graph.fanout(w) == 0) {
+                stack.push_back(w);
+            }
+        }
+    }
+    while (!stack.empty()) {
+        int g = driver[stack.back()];
+        stack.pop_back();
+        if (g < 0 || live[g]) {
+            continue;
+        }
+        live[g] = 1;
+        uint8_t op = triState.opcodes[g];
+        if (op != OP_CONST_ZERO && op != OP_CONST_ONE) {
+            for (int j = 0; j < triState.numInputs(g); ++j) {
+                stack.push_back(triState.inputs(g)[j]);
+            }
+        }
+    }
+
+    FlatNetlist kept;
+    kept.reserve(triState.size(), triState.wires.size());
+    kept.inputWireCounts = triState.inputWireCounts;
+    kept.outputWireCounts = triState.outputWireCounts;
+    for (int g = 0; g < triState.size(); ++g) {
+        if (!live[g]) {
+            continue;
+        }
+        uint8_t op = triState.opcodes[g];
+        int numGateInputs = (op == OP_CONST_ZERO || op == OP_CONST_ONE) ? 0 : triState.numInputs(g);
+        kept.addGate(op, triState.inputs(g), numGateInputs, triState.outputs(g), 1);
+    }
+    runStats().count("simplify.folded", numFolded);
+    runStats().count("simplify.forwarded", numForwarded);
+    runStats().count("simplify.removed", triState.size() - kept.size());
+
+    compactHelperWires(kept, numWires, triState.numWires);
+    triState = std::move(kept);
+    return true;
+}
+
+// Renumbers wires densely in gate order: primary inputs keep IDs
+// 0..numInputs-1, every other gate output gets the next free ID in the order
+// the gates are evaluated, and the Bristol outputs (original IDs
+// firstOutputWire.. in header order) take the last IDs. Gates are reordered
+// topologically first if they are not already. Afterwards a simulator or
+// encoder sweeping the gates writes wires sequentially, the helper wires of
+// each lowered gate sit next to their readers, and the netlist follows the
+// Bristol convention of outputs last.
+inline bool renumberWires(FlatNetlist& triState, int firstOutputWire) {
+    int numInputs = 0;
+    for (int count : triState.inputWireCounts) {
+        numInputs += count;
+    }
+    int numOutputs = 0;
+    for (int count : triState.outputWireCounts) {
+        numOutputs += count;
+    }
+
+    std::vector<int> inputWires(numInputs);
+    for (int w = 0; w < numInputs; ++w) {
+        inputWires[w] = w;
+    }
+    std::vector<int> outputWires(numOutputs);
+    for (int k = 0; k < numOutputs; ++k) {
+        outputWires[k] = firstOutputWire + k;
+    }
+    CircuitGraph graph;
+    if (!buildCircuitGraph(triState, inputWires, outputWires, graph)) {
+        return false;
+    }
+    for (int wire : outputWires) {
+        if (graph.driver[wire] < 0) {
+            std::cerr << "Output wire " << wire << " is not driven by any gate." << std::endl;
+            return false;
+        }
+    }
+    if (static_cast<int>(graph.topoOrder.size()) != triState.size()) {
+        std::cerr << "Tristate netlist has a cycle, cannot renumber." << std::endl;
+        return false;
+    }
+
+    // Keep the given order when every gate reads only earlier wires,
+    // otherwise take the graph's topological order
+    bool ordered = true;
+    for (int g = 0; g < triState.size() && ordered; ++g) {
+        for (int j = 0; j < triState.numInputs(g); ++j) {
+            ordered = ordered && graph.driver[triState.inputs(g)[j]] < g;
+        }
+    }
+    std::vector<int> order = graph.topoOrder;
+    if (ordered) {
+        for (int g = 0; g < triState.size(); ++g) {
+            order[g] = g;
+        }
+    }
+
+    std::vector<int> rename(triState.numWires, -1);
+    for (int w = 0; w < numInputs && w < triState.numWires; ++w) {
+        rename[w] = w;
+    }
+    int nextWireId = numInputs;
+    for (int g : order) {
+        for (int j = 0; j < triState.numOutputs(g); ++j) {
+            int wire = triState.outputs(g)[j];
+            bool isOutput = wire >= firstOutputWire && wire < firstOutputWire + numOutputs;
+            if (!isOutput && rename[wire] < 0) {
+                rename[wire] = nextWireId++;
+            }
+        }
+    }
+    for (int k = 0; k < numOutputs; ++k) {
+        rename[firstOutputWire + k] = nextWireId + k;
+    }
+
+    FlatNetlist renumbered;
+    renumbered.reserve(triState.size(), triState.wires.size());
+    renumbered.inputWireCounts = triState.inputWireCounts;
+    renumbered.outputWireCounts = triState.outputWireCounts;
+    std::vector<int> pins;
+    for (int g : order) {
+        int numPins = triState.numInputs(g) + triState.numOutputs(g);
+        pins.resize(numPins);
+        for (int j = 0; j < numPins; ++j) {
+            pins[j] = rename[triState.inputs(g)[j]];
+            if (pins[j] < 0) {
+                std::cerr << "Gate " << g << " reads wire " << triState.inputs(g)[j]
+                          << ", which is neither an input nor driven." << std::endl;
+                return false;
+            }
+        }
+        renumbered.addGate(triState.opcodes[g], pins.data(), triState.numInputs(g),
+                           pins.data() + triState.numInputs(g), triState.numOutputs(g));
+    }
+    renumbered.numGates = renumbered.size();
+    renumbered.numWires = nextWireId + numOutputs;
+    triState = std::move(renumbered);
+    return true;
+}
+
+// Lowers and writes one Bristol gate at a time, so neither netlist is ever
+// held in memory. A counting pass over the mapped input comes first because
+// the header needs the final gate and wire counts.
+inline bool streamTransformCircuit(const std::string& inputFilename, const std::string& outputFilename,
+                                   bool sharedConstants) {
+    ConstantPool pool = {sharedConstants, -1, -1};
+    LoweredSize total = sharedConstants ? LoweredSize{2, 2, 2} : LoweredSize{0, 0, 0};
+    {
+        ScopedPhase phase("count");
+        BristolReader counter;
+        if (!counter.open(inputFilename)) {
+            return false;
+        }
+        bool collect = runStats().enabled();
+        long long gatesPerType[OP_INVALID + 1] = {};
+        GateRecord gate;
+        while (counter.next(gate)) {
+            if (!loweredSize(gate, pool, total)) {
+                return false;
+            }
+            if (collect) {
+                gatesPerType[gate.opcode]++;
+            }
+        }
+        if (counter.failed()) {
+            return false;
+        }
+        if (collect) {
+            recordLoweringStats(gatesPerType, total.gates, total.wires);
+        }
+    }
+
+    ScopedPhase phase("transform_and_write");
+
+    BristolReader reader;
+    if (!reader.open(inputFilename)) {
+        return false;
+    }
+    std::ofstream outFile(outputFilename);
+    if (!outFile) {
+        std::cerr << "Failed to open output file: " << outputFilename << std::endl;
+        return false;
+    }
+    writeBristolHeader(outFile, total.gates, reader.numWires + total.wires,
+                       reader.inputWireCounts, reader.outputWireCounts);
+
+    FlatNetlist lowered;
+    int nextWireId = reader.numWires;
+    if (sharedConstants) {
+        initConstantPool(pool, nextWireId, lowered);
+    }
+    GateRecord gate;
+    while (reader.next(gate)) {
+        if (!lowerGate(gate, pool, nextWireId, lowered)) {
+            return false;
+        }
+        for (int g = 0; g < lowered.size(); ++g) {
+            writeBristolGate(outFile, lowered.gate(g));
+        }
+        lowered.clear();
+    }
+    return !reader.failed();
+}
+
+#endif
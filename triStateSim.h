@@ -0,0 +1,151 @@
+#ifndef TRI_STATE_SIM_H
+#define TRI_STATE_SIM_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "netlist.h"
+
+// Bit-sliced tristate simulator. Every wire is stored as two planes of
+// Words x 64 lanes that mirror the WireVars encoding used by the QBF encoder:
+// hi is v1 and lo is v2, so ZERO = (0,0), ONE = (0,1), Z = (1,0), X = (1,1).
+// With Words = 4 each gate is evaluated for 256 input vectors by a handful
+// of branch-free word operations, which the compiler maps onto AVX2.
+//
+// Pin order follows the netlists written by transformCircuit: BUFFER is
+// (data, control) and passes data when control is ONE, otherwise Z. JOIN
+// passes its first input unless that is Z, and XOR is Z if either input is Z.
+template <int Words = 4>
+class TriStateSimulator {
+public:
+    static const int LANES = 64 * Words;
+
+    TriStateSimulator() : numWires_(0) {}
+
+    bool compile(const FlatNetlist& netlist) {
+        numWires_ = netlist.numWires;
+        ops_.clear();
+        ops_.reserve(netlist.size());
+        for (int g = 0; g < netlist.size(); ++g) {
+            SimGate gate;
+            gate.op = netlist.opcodes[g];
+            bool constant = gate.op == OP_CONST_ZERO || gate.op == OP_CONST_ONE;
+            bool binary = gate.op == OP_XOR || gate.op == OP_BUFFER || gate.op == OP_JOIN;
+            if ((!constant && !binary) || netlist.numInputs(g) != (binary ? 2 : 0) ||
+                netlist.numOutputs(g) != 1) {
+                std::cerr << "Unsupported tri-state gate: " << opcodeName(gate.op) << " with "
+                          << netlist.numInputs(g) << " inputs" << std::endl;
+                return false;
+            }
+            gate.a = binary ? netlist.inputs(g)[0] : 0;
+            gate.b = binary ? netlist.inputs(g)[1] : 0;
+            gate.out = netlist.outputs(g)[0];
+            if (gate.a < 0 || gate.a >= numWires_ || gate.b < 0 || gate.b >= numWires_ ||
+                gate.out < 0 || gate.out >= numWires_) {
+                std::cerr << "Wire ID out of range in gate " << g << std::endl;
+                return false;
+            }
+            ops_.push_back(gate);
+        }
+        hi_.assign(static_cast<size_t>(numWires_) * Words, ~0ULL);
+        lo_.assign(static_cast<size_t>(numWires_) * Words, 0);
+        return true;
+    }
+
+    // Drives a wire with binary values, one bit per lane.
+    void setBinary(int wire, const uint64_t* bits) {
+        for (int k = 0; k < Words; ++k) {
+            hi_[wire * Words + k] = 0;
+            lo_[wire * Words + k] = bits[k];
+        }
+    }
+
+    // Drives a wire with arbitrary states given as hi/lo planes.
+    void setState(int wire, const uint64_t* hi, const uint64_t* lo) {
+        for (int k = 0; k < Words; ++k) {
+            hi_[wire * Words + k] = hi[k];
+            lo_[wire * Words + k] = lo[k];
+        }
+    }
+
+    const uint64_t* hi(int wire) const { return &hi_[static_cast<size_t>(wire) * Words]; }
+    const uint64_t* lo(int wire) const { return &lo_[static_cast<size_t>(wire) * Words]; }
+
+    void run() {
+        uint64_t* __restrict hi = hi_.data();
+        uint64_t* __restrict lo = lo_.data();
+        for (const SimGate& gate : ops_) {
+            uint64_t* oh = hi + static_cast<size_t>(gate.out) * Words;
+            uint64_t* ol = lo + static_cast<size_t>(gate.out) * Words;
+            const uint64_t* ah = hi + static_cast<size_t>(gate.a) * Words;
+            const uint64_t* al = lo + static_cast<size_t>(gate.a) * Words;
+            const uint64_t* bh = hi + static_cast<size_t>(gate.b) * Words;
+            const uint64_t* bl = lo + static_cast<size_t>(gate.b) * Words;
+            switch (gate.op) {
+                case OP_XOR:
+                    for (int k = 0; k < Words; ++k) {
+                        uint64_t z = ah[k] | bh[k];
+                        ol[k] = ~z & (al[k] ^ bl[k]);
+                        oh[k] = z;
+                    }
+                    break;
+                case OP_BUFFER:
+                    for (int k = 0; k < Words; ++k) {
+                        uint64_t on = ~bh[k] & bl[k];
+                        ol[k] = on & ~ah[k] & al[k];
+                        oh[k] = ~on | ah[k];
+                    }
+                    break;
+                case OP_JOIN:
+                    for (int k = 0; k < Words; ++k) {
+                        uint64_t l = (ah[k] & bl[k]) | (~ah[k] & al[k]);
+                        oh[k] = ah[k] & bh[k];
+                        ol[k] = l;
+                    }
+                    break;
+                case OP_CONST_ZERO:
+                    for (int k = 0; k < Words; ++k) {
+                        oh[k] = 0;
+                        ol[k] = 0;
+                    }
+                    break;
+                case OP_CONST_ONE:
+                    for (int k = 0; k < Words; ++k) {
+                        oh[k] = 0;
+                        ol[k] = ~0ULL;
+                    }
+                    break;
+            }
+        }
+    }
+
+private:
+    struct SimGate {
+        uint8_t op;
+        int a;
+        int b;
+        int out;
+    };
+
+    int numWires_;
+    std::vector<SimGate> ops_;
+    std::vector<uint64_t> hi_;
+    std::vector<uint64_t> lo_;
+};
+
+// Small, fast generator for random input lanes.
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif
@@ -0,0 +1,469 @@
+#ifndef WINDOW_CACHE_H
+#define WINDOW_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mappedFile.h"
+#include "netlist.h"
+#include "triStateSim.h"
+
+// Windows are cached by function, not by structure. The truth table is taken
+// over every ZERO/ONE/Z assignment of the inputs (3^n rows) and made
+// canonical under input and output permutation: inputs are ordered by a
+// permutation-invariant sensitivity signature, ties are broken by trying the
+// permutations inside each tie class, and for each candidate the output
+// columns are sorted. The smallest table wins. Wire names never enter it.
+const int CACHE_MAX_INPUTS = 10;
+const long long CACHE_MAX_PERMUTATIONS = 5040;
+
+struct CanonicalWindow {
+    int numInputs;
+    int numOutputs;
+    std::vector<uint8_t> table;   // 2-bit states, four per byte, output-major
+    uint64_t hash;
+    std::vector<int> inputOrder;  // canonical input j is window input inputOrder[j]
+    std::vector<int> outputOrder; // canonical output k is window output outputOrder[k]
+};
+
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t h = 0xCBF29CE484222325ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// Truth table of a tristate window, table[o * rows + r]. Row r assigns input
+// j the base-3 digit j of r (0 = ZERO, 1 = ONE, 2 = Z).
+inline bool windowTruthTable(const FlatNetlist& window, const std::vector<int>& inputs,
+                             const std::vector<int>& outputs, std::vector<uint8_t>& table) {
+    TriStateSimulator<4> sim;
+    if (!sim.compile(window)) {
+        return false;
+    }
+    const int LANES = TriStateSimulator<4>::LANES;
+    int n = inputs.size();
+    int rows = 1;
+    for (int j = 0; j < n; ++j) {
+        rows *= 3;
+    }
+    table.assign(static_cast<size_t>(rows) * outputs.size(), 0);
+    for (int base = 0; base < rows; base += LANES) {
+        for (int j = 0, stride = 1; j < n; ++j, stride *= 3) {
+            uint64_t hi[4] = {0, 0, 0, 0};
+            uint64_t lo[4] = {0, 0, 0, 0};
+            for (int lane = 0; lane < LANES && base + lane < rows; ++lane) {
+                int digit = (base + lane) / stride % 3;
+                hi[lane / 64] |= static_cast<uint64_t>(digit == 2) << (lane % 64);
+                lo[lane / 64] |= static_cast<uint64_t>(digit == 1) << (lane % 64);
+            }
+            sim.setState(inputs[j], hi, lo);
+        }
+        sim.run();
+        for (size_t o = 0; o < outputs.size(); ++o) {
+            const uint64_t* hi = sim.hi(outputs[o]);
+            const uint64_t* lo = sim.lo(outputs[o]);
+            for (int lane = 0; lane < LANES && base + lane < rows; ++lane) {
+                int bit = lane % 64;
+                table[o * rows + base + lane] =
+                    static_cast<uint8_t>(((hi[lane / 64] >> bit) & 1) << 1 | ((lo[lane / 64] >> bit) & 1));
+            }
+        }
+    }
+    return true;
+}
+
+// Fails for windows with more than CACHE_MAX_INPUTS inputs. Tie classes whose
+// permutations exceed CACHE_MAX_PERMUTATIONS keep signature order only, so the
+// form stays deterministic but a permuted copy may get a different key.
+inline bool canonicalizeWindow(const FlatNetlist& window, const std::vector<int>& inputs,
+                               const std::vector<int>& outputs, CanonicalWindow& canon) {
+    int n = inputs.size();
+    int m = outputs.size();
+    std::vector<uint8_t> table;
+    if (n > CACHE_MAX_INPUTS || !windowTruthTable(window, inputs, outputs, table)) {
+        return false;
+    }
+    std::vector<int> pow3(n + 1, 1);
+    for (int j = 0; j < n; ++j) {
+        pow3[j + 1] = pow3[j] * 3;
+    }
+    int rows = pow3[n];
+
+    // Signature: how many (row, output) pairs change when input j moves from
+    // ZERO to ONE, and from ZERO to Z
+    std::vector<std::pair<long long, int>> order;
+    for (int j = 0; j < n; ++j) {
+        long long toOne = 0, toZ = 0;
+        for (int o = 0; o < m; ++o) {
+            const uint8_t* column = &table[static_cast<size_t>(o) * rows];
+            for (int r = 0; r < rows; ++r) {
+                if (r / pow3[j] % 3 == 0) {
+                    toOne += column[r] != column[r + pow3[j]];
+                    toZ += column[r] != column[r + 2 * pow3[j]];
+                }
+            }
+        }
+        order.push_back(std::make_pair(toOne * (static_cast<long long>(rows) * m + 1) + toZ, j));
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<long long, int>& a, const std::pair<long long, int>& b) {
+                         return a.first > b.first;
+                     });
+    std::vector<int> inputOrder(n);
+    std::vector<std::pair<int, int>> classes; // [begin, end) in inputOrder
+    long long permutations = 1;
+    for (int j = 0; j < n; ++j) {
+        inputOrder[j] = order[j].second;
+        if (j == 0 || order[j].first != order[j - 1].first) {
+            classes.push_back(std::make_pair(j, j + 1));
+        } else {
+            classes.back().second++;
+            permutations *= classes.back().second - classes.back().first;
+        }
+    }
+    bool tryAll = permutations <= CACHE_MAX_PERMUTATIONS;
+
+    std::vector<uint8_t> best;
+    std::vector<uint8_t> candidate(table.size());
+    std::vector<int> rowMap(rows);
+    std::vector<int> outputOrder(m);
+    bool first = true;
+    for (;;) {
+        for (int r = 0; r < rows; ++r) {
+            int source = 0;
+            for (int j = 0, rest = r; j < n; ++j, rest /= 3) {
+                source += rest % 3 * pow3[inputOrder[j]];
+            }
+            rowMap[r] = source;
+        }
+        std::vector<int> columns(m);
+        for (int o = 0; o < m; ++o) {
+            columns[o] = o;
+        }
+        auto cell = [&](int o, int r) { return table[static_cast<size_t>(o) * rows + rowMap[r]]; };
+        std::sort(columns.begin(), columns.end(), [&](int a, int b) {
+            for (int r = 0; r < rows; ++r) {
+                if (cell(a, r) != cell(b, r)) {
+                    return cell(a, r) < cell(b, r);
+                }
+            }
+            return a < b;
+        });
+        for (int k = 0; k < m; ++k) {
+            for (int r = 0; r < rows; ++r) {
+                candidate[static_cast<size_t>(k) * rows + r] = cell(columns[k], r);
+            }
+        }
+        if (first || candidate < best) {
+            first = false;
+            best = candidate;
+            canon.inputOrder = inputOrder;
+            outputOrder = columns;
+        }
+
+        // Next permutation inside the tie classes, odometer style
+        size_t c = 0;
+        while (tryAll && c < classes.size() &&
+               !std::next_permutation(inputOrder.begin() + classes[c].first,
+                                      inputOrder.begin() + classes[c].second)) {
+            ++c;
+        }
+        if (!tryAll || c == classes.size()) {
+            break;
+        }
+    }
+
+    canon.numInputs = n;
+    canon.numOutputs = m;
+    canon.outputOrder = outputOrder;
+    canon.table.assign((best.size() + 3) / 4, 0);
+    for (size_t i = 0; i < best.size(); ++i) {
+        canon.table[i / 4] |= static_cast<uint8_t>(best[i] << (2 * (i % 4)));
+    }
+    int32_t shape[2] = {n, m};
+    canon.hash = fnv1a(canon.table.data(), canon.table.size(), fnv1a(shape, sizeof(shape)));
+    return true;
+}
+
+// An implementation of a canonical function. Wires 0..n-1 are the canonical
+// inputs and outputs[k] is the wire carrying canonical output k.
+struct CachedCircuit {
+    bool solved; // proven minimal by the solver, not just the best seen so far
+    FlatNetlist netlist;
+    std::vector<int> outputs;
+};
+
+// Renames a window into the canonical numbering of its function.
+inline CachedCircuit makeCachedCircuit(const FlatNetlist& window, const std::vector<int>& inputs,
+                                       const std::vector<int>& outputs, const CanonicalWindow& canon,
+                                       bool solved) {
+    int n = canon.numInputs;
+    std::vector<int> rename(window.numWires, -1);
+    for (int j = 0; j < n; ++j) {
+        rename[inputs[canon.inputOrder[j]]] = j;
+    }
+    int next = n;
+    CachedCircuit cached;
+    cached.solved = solved;
+    std::vector<int> pins;
+    for (int g = 0; g < window.size(); ++g) {
+        pins.clear();
+        int nIn = window.numInputs(g);
+        int nOut = window.numOutputs(g);
+        for (int p = 0; p < nIn + nOut; ++p) {
+            int& wire = rename[window.inputs(g)[p]];
+            if (wire < 0) {
+                wire = next++;
+            }
+            pins.push_back(wire);
+        }
+        cached.netlist.addGate(window.opcodes[g], pins.data(), nIn, pins.data() + nIn, nOut);
+    }
+    cached.netlist.numGates = cached.netlist.size();
+    cached.netlist.numWires = next;
+    for (int k = 0; k < canon.numOutputs; ++k) {
+        cached.outputs.push_back(rename[outputs[canon.outputOrder[k]]]);
+    }
+    return cached;
+}
+
+// Append-only cache file, native byte order:
+//
+//   "TWC1"
+//   records: CacheRecordHeader, packed table (padded to 4 bytes),
+//            int32 gates[numGates][4] (opcode, in1, in2, out; -1 if unused),
+//            int32 outputs[numOutputs]
+//
+// The existing file is memory-mapped and indexed by hash on open; new records
+// are kept in memory and appended by close(). A later record for the same
+// function replaces an earlier one, which is how solved results supersede
+// the windows first seen.
+const char WINDOW_CACHE_MAGIC[4] = {'T', 'W', 'C', '1'};
+
+struct CacheRecordHeader {
+    uint64_t hash;
+    uint32_t size; // whole record in bytes
+    uint16_t numInputs;
+    uint16_t numOutputs;
+    uint32_t numGates;
+    uint32_t solved;
+};
+
+class WindowCache {
+public:
+    WindowCache() : validSize_(-1) {}
+
+    WindowCache(const WindowCache&) = delete;
+    WindowCache& operator=(const WindowCache&) = delete;
+
+    // Opens or creates the cache file.
+    bool open(const std::string& filename) {
+        filename_ = filename;
+        validSize_ = -1;
+        if (access(filename.c_str(), F_OK) != 0) {
+            appended_.push_back(std::string(WINDOW_CACHE_MAGIC, sizeof(WINDOW_CACHE_MAGIC)));
+            return true;
+        }
+        if (!file_.open(filename)) {
+            std::cerr << "Failed to open cache file: " << filename << std::endl;
+            return false;
+        }
+        const char* data = file_.data();
+        size_t size = file_.size();
+        if (size < sizeof(WINDOW_CACHE_MAGIC) ||
+            std::memcmp(data, WINDOW_CACHE_MAGIC, sizeof(WINDOW_CACHE_MAGIC)) != 0) {
+            std::cerr << "Not a window cache file: " << filename << std::endl;
+            return false;
+        }
+        size_t offset = sizeof(WINDOW_CACHE_MAGIC);
+        while (offset + sizeof(CacheRecordHeader) <= size) {
+            CacheRecordHeader h;
+            std::memcpy(&h, data + offset, sizeof(h));
+            if (h.size < sizeof(h) || offset + h.size > size) {
+                break;
+            }
+            if (validRecord(data + offset)) {
+                index_[h.hash].push_back(data + offset);
+            } else {
+                std::cerr << "Ignoring corrupt record at offset " << offset << " of " << filename << std::endl;
+            }
+            offset += h.size;
+        }
+        if (offset != size) {
+            // cut the broken tail off in close(), or appended records would
+            // sit behind it where no later open can reach them
+            std::cerr << "Ignoring truncated record at the end of " << filename << std::endl;
+            validSize_ = offset;
+        }
+        return true;
+    }
+
+    size_t size() const { return index_.size(); }
+
+    bool lookup(const CanonicalWindow& canon, CachedCircuit& cached) const {
+        auto it = index_.find(canon.hash);
+        if (it == index_.end()) {
+            return false;
+        }
+        for (auto record = it->second.rbegin(); record != it->second.rend(); ++record) {
+            if (matches(*record, canon)) {
+                decode(*record, cached);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(const CanonicalWindow& canon, const CachedCircuit& cached) {
+        size_t tableBytes = (canon.table.size() + 3) / 4 * 4;
+        CacheRecordHeader h;
+        h.hash = canon.hash;
+        h.numInputs = static_cast<uint16_t>(canon.numInputs);
+        h.numOutputs = static_cast<uint16_t>(canon.numOutputs);
+        h.numGates = static_cast<uint32_t>(cached.netlist.size());
+        h.solved = cached.solved;
+        h.size = static_cast<uint32_t>(sizeof(h) + tableBytes + sizeof(int32_t) * (4 * h.numGates + h.numOutputs));
+
+        std::string record(h.size, '\0');
+        char* out = &record[0];
+        std::memcpy(out, &h, sizeof(h));
+        std::memcpy(out + sizeof(h), canon.table.data(), canon.table.size());
+        std::vector<int32_t> words;
+        for (int g = 0; g < cached.netlist.size(); ++g) {
+            int nIn = cached.netlist.numInputs(g);
+            words.push_back(cached.netlist.opcodes[g]);
+            words.push_back(nIn > 0 ? cached.netlist.inputs(g)[0] : -1);
+            words.push_back(nIn > 1 ? cached.netlist.inputs(g)[1] : -1);
+            words.push_back(cached.netlist.outputs(g)[0]);
+        }
+        words.insert(words.end(), cached.outputs.begin(), cached.outputs.end());
+        std::memcpy(out + sizeof(h) + tableBytes, words.data(), words.size() * sizeof(int32_t));
+        appended_.push_back(record);
+        index_[h.hash].push_back(appended_.back().data());
+    }
+
+    // Drops a truncated tail found by open and appends the records added
+    // since.
+    bool close() {
+        if (appended_.empty() && validSize_ < 0) {
+            return true;
+        }
+        int fd = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        bool ok = fd >= 0;
+        if (ok && validSize_ >= 0) {
+            ok = ftruncate(fd, validSize_) == 0;
+            validSize_ = -1;
+        }
+        for (const std::string& record : appended_) {
+            ok = ok && ::write(fd, record.data(), record.size()) == static_cast<ssize_t>(record.size());
+        }
+        ok = (fd < 0 || ::close(fd) == 0) && ok;
+        if (!ok) {
+            std::cerr << "Error writing cache file: " << filename_ << std::endl;
+        }
+        appended_.clear();
+        return ok;
+    }
+
+private:
+    std::string filename_;
+    MappedFile file_;
+    long long validSize_; // length of the valid prefix when open found a truncated record
+    std::deque<std::string> appended_; // deque keeps record addresses stable
+    std::unordered_map<uint64_t, std::vector<const char*>> index_;
+
+    static size_t tableBytes(const CacheRecordHeader& h) {
+        size_t rows = 1;
+        for (int j = 0; j < h.numInputs; ++j) {
+            rows *= 3;
+        }
+        size_t bytes = (rows * h.numOutputs + 3) / 4;
+        return (bytes + 3) / 4 * 4;
+    }
+
+    // Checks a framed record before it is indexed: its size must match what
+    // the header promises, and every gate must be a tristate gate over wires
+    // 0 .. numInputs + numGates - 1, so matches() and decode() stay inside it.
+    static bool validRecord(const char* record) {
+        CacheRecordHeader h;
+        std::memcpy(&h, record, sizeof(h));
+        if (h.numInputs > CACHE_MAX_INPUTS ||
+            sizeof(h) + tableBytes(h) + sizeof(int32_t) * (4 * static_cast<size_t>(h.numGates) + h.numOutputs) !=
+                h.size) {
+            return false;
+        }
+        const char* words = record + sizeof(h) + tableBytes(h);
+        long long numWires = static_cast<long long>(h.numInputs) + h.numGates;
+        auto wireAt = [&](size_t i) {
+            int32_t wire;
+            std::memcpy(&wire, words + sizeof(int32_t) * i, sizeof(wire));
+            return wire;
+        };
+        for (size_t g = 0; g < h.numGates; ++g) {
+            int32_t op = wireAt(4 * g);
+            int32_t in1 = wireAt(4 * g + 1);
+            int32_t in2 = wireAt(4 * g + 2);
+            int32_t out = wireAt(4 * g + 3);
+            bool constant = op == OP_CONST_ZERO || op == OP_CONST_ONE;
+            if (!constant && op != OP_XOR && op != OP_BUFFER && op != OP_JOIN) {
+                return false;
+            }
+            if (in1 < -1 || in1 >= numWires || in2 < -1 || in2 >= numWires || (in1 < 0 && in2 >= 0) ||
+                out < 0 || out >= numWires) {
+                return false;
+            }
+        }
+        for (size_t k = 0; k < h.numOutputs; ++k) {
+            int32_t wire = wireAt(4 * static_cast<size_t>(h.numGates) + k);
+            if (wire < 0 || wire >= numWires) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool matches(const char* record, const CanonicalWindow& canon) {
+        CacheRecordHeader h;
+        std::memcpy(&h, record, sizeof(h));
+        return h.numInputs == canon.numInputs && h.numOutputs == canon.numOutputs &&
+               std::memcmp(record + sizeof(h), canon.table.data(), canon.table.size()) == 0;
+    }
+
+    static void decode(const char* record, CachedCircuit& cached) {
+        CacheRecordHeader h;
+        std::memcpy(&h, record, sizeof(h));
+        size_t offset = sizeof(h) + tableBytes(h);
+        std::vector<int32_t> words((h.size - offset) / sizeof(int32_t));
+        std::memcpy(words.data(), record + offset, words.size() * sizeof(int32_t));
+
+        cached.solved = h.solved != 0;
+        cached.netlist = FlatNetlist();
+        cached.outputs.clear();
+        int numWires = h.numInputs;
+        for (uint32_t g = 0; g < h.numGates; ++g) {
+            const int32_t* w = &words[4 * g];
+            int in[2] = {w[1], w[2]};
+            int nIn = (w[1] >= 0) + (w[2] >= 0);
+            cached.netlist.addGate(static_cast<uint8_t>(w[0]), in, nIn, &w[3], 1);
+            numWires = std::max(numWires, w[3] + 1);
+        }
+        for (uint32_t k = 0; k < h.numOutputs; ++k) {
+            cached.outputs.push_back(words[4 * h.numGates + k]);
+        }
+        cached.netlist.numGates = cached.netlist.size();
+        cached.netlist.numWires = numWires;
+    }
+};
+
+#endif